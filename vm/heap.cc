@@ -18,6 +18,9 @@ class Region {
     Region* region = reinterpret_cast<Region*>(memory.base());
     region->memory_ = memory;
     region->object_end_ = region->object_start();
+    region->scan_next_ = nullptr;
+    region->survived_ = false;
+    region->promoted_ = false;
     return region;
   }
 
@@ -48,10 +51,39 @@ class Region {
   Region* next() const { return next_; }
   void set_next(Region* next) { next_ = next; }
 
+  // A region holding a single young large object, which has new-space
+  // alignment so the write barrier treats it as new.
+  static Region* AllocateYoungLarge(intptr_t size) {
+    Region* region = Allocate(size + AllocationSize(sizeof(Region)) +
+                              kNewObjectAlignmentOffset);
+    region->object_end_ = region->young_object() + size;
+    return region;
+  }
+  static Region* OfYoungLarge(HeapObject obj) {
+    ASSERT(obj->IsNewObject());
+    Region* region = reinterpret_cast<Region*>(obj->Addr() -
+        kNewObjectAlignmentOffset - AllocationSize(sizeof(Region)));
+    ASSERT(region->young_object() == obj->Addr());
+    return region;
+  }
+  uword young_object() const {
+    return object_start() + kNewObjectAlignmentOffset;
+  }
+
+  Region* scan_next() const { return scan_next_; }
+  void set_scan_next(Region* next) { scan_next_ = next; }
+  bool survived() const { return survived_; }
+  void set_survived(bool value) { survived_ = value; }
+  bool promoted() const { return promoted_; }
+  void set_promoted(bool value) { promoted_ = value; }
+
  private:
   Region* next_;
   VirtualMemory memory_;
   uword object_end_;
+  Region* scan_next_;
+  bool survived_;
+  bool promoted_;
 };
 
 class MarkStack {
@@ -77,32 +109,71 @@ class MarkStack {
   HeapObject stack_[];
 };
 
-Heap::Heap() :
+std::atomic<intptr_t> Heap::process_old_size_ = {0};
+
+Heap::Heap(const HeapLimits& limits) :
     top_(0),
     end_(0),
     survivor_end_(0),
     to_(),
     from_(),
     next_semispace_capacity_(kInitialSemispaceCapacity),
+    min_semispace_capacity_(kInitialSemispaceCapacity),
+    max_semispace_capacity_(kDefaultMaxSemispaceCapacity),
+    scavenge_pause_target_(kDefaultScavengePauseTarget),
+    last_scavenge_end_(OS::CurrentMonotonicNanos()),
+    young_large_(nullptr),
+    young_large_scan_(nullptr),
+    young_large_size_(0),
     regions_(nullptr),
     freelist_(),
     old_size_(0),
     old_capacity_(0),
     old_limit_(0),
+    old_space_ceiling_(limits.old_space_ceiling),
+    over_old_space_ceiling_(false),
+    reported_old_size_(0),
     remembered_set_(nullptr),
     remembered_set_size_(0),
     remembered_set_capacity_(0),
     class_table_(nullptr),
     class_table_size_(0),
     class_table_capacity_(0),
+    class_table_limit_(kDefaultClassTableLimit),
     class_table_free_(0),
+    class_table_freed_(0),
+    class_table_collections_(0),
+    class_table_growths_(0),
+    young_classes_(nullptr),
+    young_classes_size_(0),
+    young_classes_capacity_(0),
     interpreter_(nullptr),
     handles_(),
     handles_size_(0),
     ephemeron_list_(nullptr),
-    weak_list_(nullptr) {
-  to_.Allocate(kInitialSemispaceCapacity);
-  from_.Allocate(kInitialSemispaceCapacity);
+    weak_list_(nullptr),
+    migrations_(SmallInteger::New(0)),
+    migrating_cids_(nullptr),
+    pending_(nullptr),
+    pending_size_(0),
+    pending_capacity_(0),
+    has_forwarders_(false) {
+  ASSERT(IsValid(limits));
+  if (limits.initial_semispace_capacity != 0) {
+    next_semispace_capacity_ = limits.initial_semispace_capacity;
+    min_semispace_capacity_ = limits.initial_semispace_capacity;
+  }
+  if (limits.max_semispace_capacity != 0) {
+    max_semispace_capacity_ = limits.max_semispace_capacity;
+  }
+  if (max_semispace_capacity_ < min_semispace_capacity_) {
+    max_semispace_capacity_ = min_semispace_capacity_;
+  }
+  if (limits.class_table_limit != 0) {
+    class_table_limit_ = limits.class_table_limit;
+  }
+  to_.Allocate(next_semispace_capacity_);
+  from_.Allocate(next_semispace_capacity_);
   top_ = to_.object_start();
   end_ = to_.limit();
 
@@ -110,7 +181,7 @@ Heap::Heap() :
   remembered_set_ = new HeapObject[remembered_set_capacity_];
 
   // Class table.
-  class_table_capacity_ = 1024;
+  class_table_capacity_ = kInitialClassTableCapacity;
   class_table_ = new Object[class_table_capacity_];
 #if defined(DEBUG)
   for (intptr_t i = 0; i < kFirstRegularObjectCid; i++) {
@@ -121,9 +192,19 @@ Heap::Heap() :
   }
 #endif
   class_table_size_ = kFirstRegularObjectCid;
+
+  young_classes_capacity_ = 64;
+  young_classes_ = new intptr_t[young_classes_capacity_];
 }
 
 Heap::~Heap() {
+#if REPORT_GC
+  OS::PrintErr("Class table (%" Pd " capacity, %" Pd " growths, "
+               "%" Pd " class-table GCs)\n",
+               class_table_capacity_, class_table_growths_,
+               class_table_collections_);
+#endif
+  process_old_size_.fetch_sub(reported_old_size_, std::memory_order_relaxed);
   to_.Free();
   from_.Free();
   Region* region = regions_;
@@ -132,8 +213,17 @@ Heap::~Heap() {
     region->Free();
     region = next;
   }
+  region = young_large_;
+  while (region != nullptr) {
+    Region* next = region->next();
+    region->Free();
+    region = next;
+  }
   delete[] remembered_set_;
   delete[] class_table_;
+  delete[] young_classes_;
+  delete[] migrating_cids_;
+  delete[] pending_;
 }
 
 Message Heap::AllocateMessage() {
@@ -175,6 +265,41 @@ uword Heap::AllocateNew(intptr_t size) {
   return addr;
 }
 
+uword Heap::AllocateNewLarge(intptr_t size, bool zero) {
+  ASSERT(size >= kLargeAllocation);
+  // Young large objects are bounded by the size of to-space, so dead ones are
+  // reclaimed at the same rate as other new objects.
+  if (young_large_size_ + size > to_.size()) {
+    // An object bigger than to-space would not fit even after a scavenge.
+    if (size <= static_cast<intptr_t>(to_.size())) {
+      Scavenge(kNewSpace);
+      if (old_size_ > old_limit_) {
+        MarkSweep(kTenure);
+      }
+    }
+    if (young_large_size_ + size > to_.size()) {
+      uword addr = AllocateOldLarge(size, kControlGrowth);
+      if (zero) {
+        memset(reinterpret_cast<void*>(addr), 0, size);
+      }
+      return addr;
+    }
+  }
+  Region* region = Region::AllocateYoungLarge(size);
+  region->set_next(young_large_);
+  young_large_ = region;
+  young_large_size_ += size;
+  uword addr = region->young_object();
+  ASSERT((addr & kObjectAlignmentMask) == kNewObjectAlignmentOffset);
+  // Fresh pages from the OS are already zero.
+#if defined(DEBUG)
+  if (!zero) {
+    memset(reinterpret_cast<void*>(addr), kUninitializedByte, size);
+  }
+#endif
+  return addr;
+}
+
 uword Heap::AllocateTenure(intptr_t size) {
   uword result = AllocateOldSmall(size, kForceGrowth);
   PushTenureStack(result);
@@ -276,6 +401,7 @@ Region* Heap::AllocateRegion(intptr_t region_size, GrowthPolicy growth) {
   old_capacity_ += region->size();
   region->set_next(regions_);
   regions_ = region;
+  ReportOldSize();
   return region;
 }
 
@@ -318,8 +444,8 @@ void Heap::ShrinkRememberedSet() {
 
 NOINLINE
 void Heap::Scavenge(Reason reason) {
-#if REPORT_GC
   int64_t start = OS::CurrentMonotonicNanos();
+#if REPORT_GC
   size_t new_before = top_ - to_.object_start();
 #endif
   size_t old_before = old_size_;
@@ -335,17 +461,21 @@ void Heap::Scavenge(Reason reason) {
   // Strong references.
   ScavengeRoots();
   uword scan = to_.object_start();
-  while (scan < top_ || end_ < to_.limit()) {
+  while (scan < top_ || end_ < to_.limit() || young_large_scan_ != nullptr) {
     scan = ScavengeToSpace(scan);
     ProcessTenureStack();
+    ProcessYoungLargeScanList();
     ScavengeEphemeronList();
   }
 
   // Weak references.
   MournEphemeronList();
   MournWeakListScavenge();
+  MournPendingScavenge();
   MournClassTableScavenge();
 
+  SweepYoungLargeScavenge();
+
 #if defined(DEBUG)
   from_.MarkUnallocated();
   from_.NoAccess();
@@ -360,16 +490,19 @@ void Heap::Scavenge(Reason reason) {
   size_t tenured = old_after - old_before;
   size_t survived = new_after + tenured;
 
-  if (survived > (to_.size() / 3)) {
-    next_semispace_capacity_ = to_.size() * 2;
-    if (next_semispace_capacity_ > kMaxSemispaceCapacity) {
-      next_semispace_capacity_ = kMaxSemispaceCapacity;
-    }
+  int64_t stop = OS::CurrentMonotonicNanos();
+  if (reason == kNewSpace) {
+    // Other scavenges are not paced by allocation.
+    SetSemispaceCapacity(stop - start, start - last_scavenge_end_, survived);
+  }
+  last_scavenge_end_ = stop;
+  if (to_.base() + next_semispace_capacity_ < end_) {
+    end_ = to_.base() + next_semispace_capacity_;
   }
+  ASSERT(end_ >= top_);
 
 #if REPORT_GC
   size_t freed = (new_before + old_before) - (new_after + old_after);
-  int64_t stop = OS::CurrentMonotonicNanos();
   int64_t time = stop - start;
   OS::PrintErr("Scavenge (%s, %" Pd "kB new, "
                "%" Pd "kB tenured, %" Pd "kB freed, %" Pd64 " us)\n",
@@ -378,22 +511,120 @@ void Heap::Scavenge(Reason reason) {
 #endif
 }
 
+// Capacity is chosen from the last pause, the mutator time before it and how
+// much survived:
+//  - Over the pause target, halve. Survivors are roughly proportional to the
+//    capacity, and so is the pause.
+//  - Well under the target, double if many survivors are being tenured
+//    early. Growing only to scavenge less often does not pay: a new space
+//    that stays in cache allocates faster.
+//  - Idle for longer than kIdleInterval, with few survivors, halve to give
+//    back memory and cache. Shrinking a busy new space would only trade
+//    cheap scavenges for more frequent ones.
+// Capacity stays at least twice the current survivors so they fit with room
+// to allocate.
+void Heap::SetSemispaceCapacity(int64_t pause, int64_t interval,
+                                size_t survived) {
+  static constexpr int64_t kIdleInterval = kNanosecondsPerSecond / 2;
+
+  size_t capacity = next_semispace_capacity_;
+  if (pause > scavenge_pause_target_) {
+    capacity /= 2;
+  } else if ((pause * 2 <= scavenge_pause_target_) &&
+             (survived > capacity / 3)) {
+    capacity *= 2;
+  } else if ((survived < capacity / 8) && (interval > kIdleInterval)) {
+    capacity /= 2;
+  }
+
+  size_t floor = min_semispace_capacity_;
+  size_t new_after = top_ - to_.object_start();
+  while (floor < 2 * new_after) {
+    floor *= 2;
+  }
+  if (capacity < floor) {
+    capacity = floor;
+  }
+  if (capacity > max_semispace_capacity_) {
+    capacity = max_semispace_capacity_;
+  }
+  if (capacity < new_after) {
+    // Lowered maximum; wait for survivors to drain.
+    capacity = next_semispace_capacity_;
+  }
+
+  if (TRACE_GROWTH && (capacity != next_semispace_capacity_)) {
+    OS::PrintErr("%s new space to %" Pd "kB (%" Pd64 " us pause, "
+                 "%" Pd64 " us interval, %" Pd "kB survived)\n",
+                 capacity > next_semispace_capacity_ ? "Growing" : "Shrinking",
+                 capacity / KB, pause / kNanosecondsPerMicrosecond,
+                 interval / kNanosecondsPerMicrosecond, survived / KB);
+  }
+  next_semispace_capacity_ = capacity;
+}
+
+bool Heap::IsValidSemispaceCapacity(size_t capacity) {
+  return Utils::IsPowerOfTwo(capacity) &&
+      (capacity >= kMinSemispaceCapacity) &&
+      (capacity <= kMaxSemispaceCapacity);
+}
+
+bool Heap::IsValid(const HeapLimits& limits) {
+  if ((limits.initial_semispace_capacity != 0) &&
+      !IsValidSemispaceCapacity(limits.initial_semispace_capacity)) {
+    return false;
+  }
+  if ((limits.max_semispace_capacity != 0) &&
+      !IsValidSemispaceCapacity(limits.max_semispace_capacity)) {
+    return false;
+  }
+  if ((limits.initial_semispace_capacity != 0) &&
+      (limits.max_semispace_capacity != 0) &&
+      (limits.initial_semispace_capacity > limits.max_semispace_capacity)) {
+    return false;
+  }
+  // No more ids than the header's class id field can hold.
+  if ((limits.class_table_limit < 0) ||
+      (limits.class_table_limit >
+       (static_cast<intptr_t>(1) << kClassIdFieldSize))) {
+    return false;
+  }
+  return true;
+}
+
+bool Heap::SetNewSpacePolicy(int64_t pause_target, size_t max_capacity) {
+  if ((pause_target <= 0) ||
+      !IsValidSemispaceCapacity(max_capacity) ||
+      (max_capacity < min_semispace_capacity_)) {
+    return false;
+  }
+  scavenge_pause_target_ = pause_target;
+  // A lower maximum applies from the next scavenge, once survivors fit.
+  max_semispace_capacity_ = max_capacity;
+  return true;
+}
+
 void Heap::FlipSpaces() {
+  // Everything allocated in to-space since the last scavenge may survive, and
+  // the allocation limit kept that within the next capacity.
+  size_t used = top_ - to_.base();
+  ASSERT(used <= next_semispace_capacity_);
+
   Semispace temp = to_;
   to_ = from_;
   from_ = temp;
 
   ASSERT(next_semispace_capacity_ <= kMaxSemispaceCapacity);
-  if (to_.size() < next_semispace_capacity_) {
-    if (TRACE_GROWTH && (from_.size() < next_semispace_capacity_)) {
-      OS::PrintErr("Growing new space to %" Pd "MB\n",
-                   next_semispace_capacity_ / MB);
-    }
+  // A lower capacity only moves the allocation limit until the memory beyond
+  // it is large enough to be worth returning, so capacity oscillating around a
+  // boundary does not map fresh pages on each scavenge.
+  if ((to_.size() < next_semispace_capacity_) ||
+      (to_.size() >= 4 * next_semispace_capacity_)) {
     to_.Free();
     to_.Allocate(next_semispace_capacity_);
   }
 
-  ASSERT(to_.size() >= from_.size());
+  ASSERT(to_.size() >= used);
 
   top_ = to_.object_start();
   end_ = to_.limit();
@@ -434,6 +665,9 @@ void Heap::ScavengeRoots() {
   for (intptr_t i = 0; i < saved_remembered_set_size; i++) {
     HeapObject obj = remembered_set_[i];
     ASSERT(obj->IsOldObject());
+    if (obj->IsForwardingCorpse()) {
+      continue;  // Migrated since it was remembered.
+    }
     ASSERT(obj->is_remembered());
     obj->set_is_remembered(false);
     ScavengeOldObject(obj);
@@ -453,6 +687,7 @@ void Heap::ScavengeRoots() {
   for (Object* ptr = from; ptr <= to; ptr++) {
     ScavengePointer(ptr);
   }
+  ScavengePointer(&migrations_);
 }
 
 uword Heap::ScavengeToSpace(uword scan) {
@@ -518,6 +753,12 @@ static HeapObject ForwardingTarget(HeapObject obj) {
   return static_cast<HeapObject>(header);
 }
 
+// A forwarder left by a migration rather than by this scavenge. Its target is
+// always in old-space, so pointers to it are redirected instead of copying it.
+static bool IsMigrationForwarder(HeapObject obj) {
+  return !IsForwarded(obj) && obj->IsForwardingCorpse();
+}
+
 static void SetForwarded(HeapObject old_obj, HeapObject new_obj) {
   ASSERT(old_obj->IsNewObject());
   ASSERT(!IsForwarded(old_obj));
@@ -533,6 +774,16 @@ bool Heap::ScavengePointer(Object* ptr) {
     return false;
   }
 
+  if (has_forwarders_ && IsMigrationForwarder(old_target)) {
+    *ptr = static_cast<ForwardingCorpse>(old_target)->target();
+    ASSERT((*ptr)->IsImmediateOrOldObject());
+    return false;
+  }
+
+  if (IsYoungLarge(old_target)) {
+    return ScavengeYoungLarge(ptr);
+  }
+
   DEBUG_ASSERT(InFromSpace(old_target));
 
   HeapObject new_target;
@@ -563,6 +814,109 @@ bool Heap::ScavengePointer(Object* ptr) {
   return new_target->IsNewObject();
 }
 
+bool Heap::ScavengeYoungLarge(Object* ptr) {
+  HeapObject old_target = static_cast<HeapObject>(*ptr);
+  Region* region = Region::OfYoungLarge(old_target);
+
+  // For young large objects, the mark bit means reachable in place, or
+  // forwarded if the region is promoted.
+  if (!IsForwarded(old_target)) {
+    if (region->survived()) {
+      // Second scavenge survived: promote to old-space.
+      intptr_t size = old_target->HeapSize();
+      uword new_target_addr = AllocateOldLarge(size, kForceGrowth);
+      memcpy(reinterpret_cast<void*>(new_target_addr),
+             reinterpret_cast<void*>(old_target->Addr()),
+             size);
+      SetForwarded(old_target, HeapObject::FromAddr(new_target_addr));
+      region->set_promoted(true);
+    } else {
+      old_target->set_is_marked(true);
+    }
+    region->set_scan_next(young_large_scan_);
+    young_large_scan_ = region;
+  }
+
+  if (region->promoted()) {
+    *ptr = ForwardingTarget(old_target);
+    return false;
+  }
+  return true;
+}
+
+void Heap::ProcessYoungLargeScanList() {
+  while (young_large_scan_ != nullptr) {
+    Region* region = young_large_scan_;
+    young_large_scan_ = region->scan_next();
+    region->set_scan_next(nullptr);
+
+    HeapObject obj = HeapObject::FromAddr(region->young_object());
+    if (region->promoted()) {
+      ScavengeOldObject(ForwardingTarget(obj));
+      continue;
+    }
+
+    intptr_t cid = obj->cid();
+    if (cid == kWeakArrayCid) {
+      AddToWeakList(static_cast<WeakArray>(obj));
+    } else {
+      ASSERT(cid != kEphemeronCid);
+      ScavengeClass(cid);
+      Object* from;
+      Object* to;
+      obj->Pointers(&from, &to);
+      for (Object* ptr = from; ptr <= to; ptr++) {
+        ScavengePointer(ptr);
+      }
+    }
+  }
+}
+
+void Heap::SweepYoungLargeScavenge() {
+  Region* prev = nullptr;
+  Region* region = young_large_;
+  while (region != nullptr) {
+    Region* next = region->next();
+    HeapObject obj = HeapObject::FromAddr(region->young_object());
+    if (!region->promoted() && obj->is_marked()) {
+      obj->set_is_marked(false);
+      region->set_survived(true);
+      prev = region;
+    } else {
+      if (prev == nullptr) {
+        young_large_ = next;
+      } else {
+        prev->set_next(next);
+      }
+      young_large_size_ -= region->object_end() - region->young_object();
+      region->Free();
+    }
+    region = next;
+  }
+}
+
+void Heap::SweepYoungLargeMarkSweep() {
+  Region* prev = nullptr;
+  Region* region = young_large_;
+  while (region != nullptr) {
+    Region* next = region->next();
+    HeapObject obj = HeapObject::FromAddr(region->young_object());
+    if (obj->is_marked()) {
+      obj->set_is_marked(false);
+      prev = region;
+    } else {
+      if (prev == nullptr) {
+        young_large_ = next;
+      } else {
+        prev->set_next(next);
+      }
+      young_large_size_ -= region->object_end() - region->young_object();
+      region->Free();
+    }
+    region = next;
+  }
+}
+
 void Heap::ScavengeOldObject(HeapObject obj) {
   intptr_t cid = obj->cid();
   if (cid == kWeakArrayCid) {
@@ -643,6 +997,8 @@ void Heap::MarkSweep(Reason reason) {
 
   interpreter_->GCPrologue();
 
+  shared_graphs_.ClearReached();
+
   // Strong references.
   MarkRoots();
   while (!mark_stack->IsEmpty()) {
@@ -659,14 +1015,21 @@ void Heap::MarkSweep(Reason reason) {
   // Weak references.
   MournEphemeronList();
   MournWeakListMarkSweep();
+  MournPendingMarkSweep();
   MournClassTableMarkSweep();
+  shared_graphs_.ReleaseUnreached();
 
   interpreter_->GCEpilogue();
 
   Sweep();
+  old_size_ += shared_graphs_.total_size();
+
+  // Every surviving pointer to a forwarder has been redirected.
+  has_forwarders_ = false;
 
   ShrinkRememberedSet();
 
+  ReportOldSize();
   SetOldAllocationLimit();
 
 #if REPORT_GC
@@ -683,18 +1046,28 @@ void Heap::MarkSweep(Reason reason) {
 
 void Heap::MarkRoots() {
   for (intptr_t i = 0; i < handles_size_; i++) {
-    MarkObject(*handles_[i]);
+    MarkPointer(handles_[i]);
   }
 
   Object* from;
   Object* to;
   interpreter_->RootPointers(&from, &to);
   for (Object* ptr = from; ptr <= to; ptr++) {
-    MarkObject(*ptr);
+    MarkPointer(ptr);
   }
   interpreter_->StackPointers(&from, &to);
   for (Object* ptr = from; ptr <= to; ptr++) {
-    MarkObject(*ptr);
+    MarkPointer(ptr);
+  }
+  MarkObject(migrations_);
+}
+
+void Heap::SkipForwarder(Object* ptr) {
+  // Forwarders left by migrations are not retained: each pointer to one is
+  // redirected to its target as the marker visits it.
+  if (has_forwarders_ && (*ptr)->IsForwardingCorpse()) {
+    *ptr = static_cast<ForwardingCorpse>(*ptr)->target();
+    ASSERT(!(*ptr)->IsForwardingCorpse());
   }
 }
 
@@ -702,7 +1075,14 @@ void Heap::MarkObject(Object obj) {
   if (obj->IsImmediateObject()) return;
 
   HeapObject heap_obj = static_cast<HeapObject>(obj);
-  if (heap_obj->is_marked()) return;
+  if (heap_obj->is_marked()) {
+    // Shared objects are always marked, but their graph is only kept if
+    // something points into it.
+    if (heap_obj->is_shared()) {
+      shared_graphs_.MarkReached(heap_obj);
+    }
+    return;
+  }
 
   heap_obj->set_is_marked(true);
   heap_obj->set_is_remembered(false);
@@ -734,6 +1114,7 @@ void Heap::ProcessMarkStack() {
       obj->Pointers(&from, &to);
       bool has_new_target = ClassAt(cid)->IsNewObject();
       for (Object* ptr = from; ptr <= to; ptr++) {
+        SkipForwarder(ptr);
         Object target = *ptr;
         has_new_target |= target->IsNewObject();
         MarkObject(target);
@@ -777,6 +1158,8 @@ void Heap::Sweep() {
     }
   }
 
+  SweepYoungLargeMarkSweep();
+
   Region* prev = nullptr;
   Region* region = regions_;
   while (region != nullptr) {
@@ -829,8 +1212,48 @@ bool Heap::SweepRegion(Region* region) {
   return true;  // In use.
 }
 
+void Heap::ReportOldSize() {
+  intptr_t delta = static_cast<intptr_t>(old_size_) -
+      static_cast<intptr_t>(reported_old_size_);
+  process_old_size_.fetch_add(delta, std::memory_order_relaxed);
+  reported_old_size_ = old_size_;
+}
+
 void Heap::SetOldAllocationLimit() {
   old_limit_ = old_size_ + old_size_ / 2;
+  // Near the memory available to the process, collect more often instead of
+  // growing into the container's OOM killer. The old spaces of all isolates
+  // together are kept within half of it, leaving the rest for new spaces and
+  // the rest of the process. This heap cannot free the other heaps' objects,
+  // so a budget they have already spent only narrows its headroom, down to a
+  // quarter of its own live size, rather than collecting it after every region.
+  int64_t ceiling = OS::MemoryLimit() / 2;
+  if (ceiling > 0) {
+    int64_t others = process_old_size_.load(std::memory_order_relaxed) -
+        static_cast<int64_t>(reported_old_size_);
+    int64_t budget = ceiling - others;
+    int64_t minimum = static_cast<int64_t>(old_size_ + old_size_ / 4);
+    if (budget < minimum) {
+      budget = minimum;
+    }
+    if (static_cast<uint64_t>(budget) < old_limit_) {
+      old_limit_ = static_cast<size_t>(budget);
+    }
+  }
+  if (old_space_ceiling_ != 0) {
+    if (old_space_ceiling_ < old_limit_) {
+      old_limit_ = old_space_ceiling_;
+    }
+    // Past the ceiling, the floor below collects after every two regions,
+    // each time tracing the whole live heap.
+    bool over = old_size_ > old_space_ceiling_;
+    if (over && !over_old_space_ceiling_) {
+      OS::PrintErr("Warning: %" Pd "kB live old space exceeds the isolate's "
+                   "%" Pd "kB limit\n",
+                   old_size_ / KB, old_space_ceiling_ / KB);
+    }
+    over_old_space_ceiling_ = over;
+  }
   if (old_limit_ < old_size_ + 2 * kRegionSize) {
     old_limit_ = old_size_ + 2 * kRegionSize;
   }
@@ -860,6 +1283,11 @@ void Heap::ScavengeEphemeronList() {
     Ephemeron next = survivor->next();
     survivor->set_next(nullptr);
 
+    if (has_forwarders_ && survivor->key()->IsNewObject() &&
+        IsMigrationForwarder(static_cast<HeapObject>(survivor->key()))) {
+      ScavengePointer(survivor->key_ptr());
+    }
+
     if (IsScavengeSurvivor(survivor->key())) {
       ScavengePointer(survivor->key_ptr());
       ScavengePointer(survivor->value_ptr());
@@ -882,8 +1310,15 @@ void Heap::ScavengeEphemeronList() {
   }
 }
 
-static bool IsMarkSweepSurvivor(Object obj) {
-  return obj->IsImmediateObject() || static_cast<HeapObject>(obj)->is_marked();
+bool Heap::IsMarkSweepSurvivor(Object obj) const {
+  if (obj->IsImmediateObject()) {
+    return true;
+  }
+  HeapObject heap_obj = static_cast<HeapObject>(obj);
+  if (heap_obj->is_shared()) {
+    return shared_graphs_.IsReached(heap_obj);
+  }
+  return heap_obj->is_marked();
 }
 
 void Heap::MarkEphemeronList() {
@@ -895,10 +1330,13 @@ void Heap::MarkEphemeronList() {
     Ephemeron next = survivor->next();
     survivor->set_next(nullptr);
 
+    SkipForwarder(survivor->key_ptr());
     if (IsMarkSweepSurvivor(survivor->key())) {
       // TODO(rmacnak): These scavenges potentially add to the ephemeron list
       // that we are in the middle of traversing. Add tests for ephemerons
       // only reachable from another ephemeron.
+      SkipForwarder(survivor->value_ptr());
+      SkipForwarder(survivor->finalizer_ptr());
       MarkObject(survivor->key());
       MarkObject(survivor->value());
       MarkObject(survivor->finalizer());
@@ -941,7 +1379,8 @@ void Heap::MournEphemeronList() {
 }
 
 void Heap::AddToWeakList(WeakArray survivor) {
-  DEBUG_ASSERT(survivor->IsOldObject() || InToSpace(survivor));
+  DEBUG_ASSERT(survivor->IsOldObject() || InToSpace(survivor) ||
+               IsYoungLarge(survivor));
   survivor->set_next(weak_list_);
   weak_list_ = survivor;
 }
@@ -1003,6 +1442,20 @@ void Heap::MournWeakPointerScavenge(Object* ptr) {
     return;
   }
 
+  if (has_forwarders_ && IsMigrationForwarder(old_target)) {
+    *ptr = static_cast<ForwardingCorpse>(old_target)->target();
+    return;
+  }
+
+  if (IsYoungLarge(old_target)) {
+    if (!IsForwarded(old_target)) {
+      *ptr = interpreter_->nil_obj();
+    } else if (Region::OfYoungLarge(old_target)->promoted()) {
+      *ptr = ForwardingTarget(old_target);
+    }
+    return;
+  }
+
   DEBUG_ASSERT(InFromSpace(old_target));
 
   HeapObject new_target;
@@ -1019,6 +1472,7 @@ void Heap::MournWeakPointerScavenge(Object* ptr) {
 }
 
 void Heap::MournWeakPointerMarkSweep(Object* ptr) {
+  SkipForwarder(ptr);
   Object target = *ptr;
 
   if (IsMarkSweepSurvivor(target)) {
@@ -1031,7 +1485,12 @@ void Heap::MournWeakPointerMarkSweep(Object* ptr) {
 }
 
 void Heap::MournClassTableScavenge() {
-  for (intptr_t i = kFirstLegalCid; i < class_table_size_; i++) {
+  // Only classes in new-space can die in a scavenge, so only visit the young
+  // classes, keeping those that survive in new-space.
+  intptr_t size = young_classes_size_;
+  young_classes_size_ = 0;
+  for (intptr_t j = 0; j < size; j++) {
+    intptr_t i = young_classes_[j];
     Object* ptr = &class_table_[i];
 
     HeapObject old_target = static_cast<HeapObject>(*ptr);
@@ -1045,14 +1504,25 @@ void Heap::MournClassTableScavenge() {
       HeapObject new_target = ForwardingTarget(old_target);
       DEBUG_ASSERT(new_target->IsOldObject() || InToSpace(new_target));
       *ptr = new_target;
+      if (new_target->IsNewObject()) {
+        young_classes_[young_classes_size_++] = i;
+      }
     } else {
       *ptr = SmallInteger::New(class_table_free_);
       class_table_free_ = i;
     }
   }
+
+#if defined(DEBUG)
+  for (intptr_t i = kFirstLegalCid; i < class_table_size_; i++) {
+    ASSERT(!class_table_[i]->IsNewObject() || !InFromSpace(
+        static_cast<HeapObject>(class_table_[i])));
+  }
+#endif
 }
 
 void Heap::MournClassTableMarkSweep() {
+  class_table_freed_ = 0;
   for (intptr_t i = kFirstLegalCid; i < class_table_size_; i++) {
     Object* ptr = &class_table_[i];
 
@@ -1064,6 +1534,32 @@ void Heap::MournClassTableMarkSweep() {
 
     *ptr = SmallInteger::New(class_table_free_);
     class_table_free_ = i;
+    class_table_freed_++;
+  }
+
+  RebuildYoungClasses();
+}
+
+void Heap::GrowYoungClasses() {
+  young_classes_capacity_ += (young_classes_capacity_ >> 1);
+  if (TRACE_GROWTH) {
+    OS::PrintErr("Growing young classes to %" Pd "\n",
+                 young_classes_capacity_);
+  }
+  intptr_t* old_young_classes = young_classes_;
+  young_classes_ = new intptr_t[young_classes_capacity_];
+  for (intptr_t i = 0; i < young_classes_size_; i++) {
+    young_classes_[i] = old_young_classes[i];
+  }
+  delete[] old_young_classes;
+}
+
+void Heap::RebuildYoungClasses() {
+  young_classes_size_ = 0;
+  for (intptr_t i = kFirstLegalCid; i < class_table_size_; i++) {
+    if (class_table_[i]->IsNewObject()) {
+      AddToYoungClasses(i);
+    }
   }
 }
 
@@ -1080,11 +1576,18 @@ void Heap::MournClassTableForwarded() {
   }
 }
 
-bool Heap::BecomeForward(Array old, Array neu) {
+bool Heap::BecomeForward(Array old, Array neu, Array migrations) {
   if (old->Size() != neu->Size()) {
     return false;
   }
 
+  {
+    // Finish any earlier migration so no instance is more than one shape
+    // behind and no forwarder is left to be forwarded again.
+    HandleScope h1(this, reinterpret_cast<Object*>(&migrations));
+    FinishMigration();
+  }
+
   intptr_t length = old->Size();
   if (TRACE_BECOME) {
     OS::PrintErr("become(%" Pd ")\n", length);
@@ -1097,6 +1600,10 @@ bool Heap::BecomeForward(Array old, Array neu) {
         forwardee->IsImmediateObject()) {
       return false;
     }
+    if (static_cast<HeapObject>(forwarder)->is_shared() ||
+        static_cast<HeapObject>(forwardee)->is_shared()) {
+      return false;
+    }
   }
 
   interpreter_->GCPrologue();  // Before creating forwarders!
@@ -1123,10 +1630,19 @@ bool Heap::BecomeForward(Array old, Array neu) {
     corpse->set_target(forwardee);
   }
 
+  if (migrations != nullptr) {
+    BeginMigration(migrations);  // Before forwarding class ids.
+  }
+
   ForwardClassIds();
   ForwardRoots();
   ForwardHeap();  // With forwarded class ids.
   MournClassTableForwarded();
+  RebuildYoungClasses();
+
+  if ((migrating_cids_ != nullptr) && (pending_size_ == 0)) {
+    EndMigration();  // No instances.
+  }
 
   interpreter_->GCEpilogue();
 
@@ -1148,6 +1664,7 @@ void Heap::ForwardRoots() {
   for (Object* ptr = from; ptr <= to; ptr++) {
     ForwardPointer(ptr);
   }
+  ForwardPointer(&migrations_);
 }
 
 void Heap::ForwardHeap() {
@@ -1156,6 +1673,9 @@ void Heap::ForwardHeap() {
     HeapObject obj = HeapObject::FromAddr(scan);
     if (obj->cid() >= kFirstLegalCid) {
       ForwardClass(this, obj);
+      if (IsMigratingCid(obj->cid())) {
+        AddToPending(obj);
+      }
       Object* from;
       Object* to;
       obj->Pointers(&from, &to);
@@ -1166,6 +1686,28 @@ void Heap::ForwardHeap() {
     scan += obj->HeapSize();
   }
 
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    uword scan = region->young_object();
+    while (scan < region->object_end()) {
+      HeapObject obj = HeapObject::FromAddr(scan);
+      if (obj->cid() >= kFirstLegalCid) {
+        ForwardClass(this, obj);
+        if (IsMigratingCid(obj->cid())) {
+          AddToPending(obj);
+        }
+        Object* from;
+        Object* to;
+        obj->Pointers(&from, &to);
+        for (Object* ptr = from; ptr <= to; ptr++) {
+          ForwardPointer(ptr);
+        }
+      }
+      scan += obj->HeapSize();
+    }
+  }
+
   remembered_set_size_ = 0;
   for (Region* region = regions_; region != nullptr; region = region->next()) {
     uword scan = region->object_start();
@@ -1176,6 +1718,9 @@ void Heap::ForwardHeap() {
         if (ForwardClass(this, obj)) {
           has_new_target = true;
         }
+        if (IsMigratingCid(obj->cid())) {
+          AddToPending(obj);
+        }
         obj->set_is_remembered(false);
         Object* from;
         Object* to;
@@ -1236,42 +1781,244 @@ void Heap::ForwardClassIds() {
   }
 }
 
+void Heap::BeginMigration(Array migrations) {
+  ASSERT(migrating_cids_ == nullptr);
+  ASSERT(pending_size_ == 0);
+  Object nil = interpreter_->nil_obj();
+  for (intptr_t i = 0; i < migrations->Size(); i += 3) {
+    Behavior migration_class = static_cast<Behavior>(migrations->element(i));
+    if (migration_class == nil) {
+      continue;  // The old class has no instances.
+    }
+    intptr_t cid = migration_class->id()->value();
+    if (!class_table_[cid]->IsForwardingCorpse()) {
+      continue;  // The old class is not being forwarded.
+    }
+    // The migration class takes over the old class's id, so ForwardClassIds
+    // leaves it alone and the instances keep their old shape until migrated.
+    class_table_[cid] = migration_class;
+    if (migrating_cids_ == nullptr) {
+      migrating_cids_ = new uint8_t[class_table_capacity_];
+      memset(migrating_cids_, 0, class_table_capacity_);
+    }
+    migrating_cids_[cid] = 1;
+  }
+  if (migrating_cids_ != nullptr) {
+    migrations_ = migrations;
+  }
+}
+
+void Heap::EndMigration() {
+  ASSERT(pending_size_ == 0);
+  delete[] migrating_cids_;
+  migrating_cids_ = nullptr;
+  delete[] pending_;
+  pending_ = nullptr;
+  pending_capacity_ = 0;
+  // The migration classes are left for the class table to mourn.
+  migrations_ = SmallInteger::New(0);
+}
+
+void Heap::GrowPending() {
+  if (pending_capacity_ == 0) {
+    pending_capacity_ = 64;
+  } else {
+    pending_capacity_ += (pending_capacity_ >> 1);
+  }
+  if (TRACE_GROWTH) {
+    OS::PrintErr("Growing pending migrations to %" Pd "\n",
+                 pending_capacity_);
+  }
+  HeapObject* old_pending = pending_;
+  pending_ = new HeapObject[pending_capacity_];
+  for (intptr_t i = 0; i < pending_size_; i++) {
+    pending_[i] = old_pending[i];
+  }
+  delete[] old_pending;
+}
+
+void Heap::MournPendingScavenge() {
+  intptr_t size = pending_size_;
+  pending_size_ = 0;
+  for (intptr_t i = 0; i < size; i++) {
+    Object obj = pending_[i];
+    MournWeakPointerScavenge(&obj);
+    if (IsMigratingCid(obj->ClassId())) {
+      pending_[pending_size_++] = static_cast<HeapObject>(obj);
+    }
+  }
+  if ((migrating_cids_ != nullptr) && (pending_size_ == 0)) {
+    EndMigration();
+  }
+}
+
+void Heap::MournPendingMarkSweep() {
+  intptr_t size = pending_size_;
+  pending_size_ = 0;
+  for (intptr_t i = 0; i < size; i++) {
+    Object obj = pending_[i];
+    MournWeakPointerMarkSweep(&obj);
+    if (IsMigratingCid(obj->ClassId())) {
+      pending_[pending_size_++] = static_cast<HeapObject>(obj);
+    }
+  }
+  if ((migrating_cids_ != nullptr) && (pending_size_ == 0)) {
+    EndMigration();
+  }
+}
+
+NOINLINE
+Object Heap::ResolveMigrating(Object obj) {
+  while (obj->IsHeapObject()) {
+    HeapObject heap_obj = static_cast<HeapObject>(obj);
+    intptr_t cid = heap_obj->cid();
+    if (cid == kForwardingCorpseCid) {
+      obj = static_cast<ForwardingCorpse>(heap_obj)->target();
+    } else if (IsMigratingCid(cid)) {
+      return Migrate(heap_obj);
+    } else {
+      break;
+    }
+  }
+  return obj;
+}
+
+// Gives an instance of a migration class the shape of the new class. If the
+// new shape fits, the instance is rewritten in place. Otherwise it is copied
+// to old-space and left as a forwarder, which the next mark-sweep removes.
+// Does not GC.
+Object Heap::Migrate(HeapObject obj) {
+  ASSERT(IsMigratingCid(obj->cid()));
+  Array migrations = static_cast<Array>(migrations_);
+  Object migration_class = class_table_[obj->cid()];
+  intptr_t i = 0;
+  while (migrations->element(i) != migration_class) {
+    i += 3;
+    ASSERT(i < migrations->Size());
+  }
+  Behavior new_class = static_cast<Behavior>(migrations->element(i + 1));
+  Array slot_map = static_cast<Array>(migrations->element(i + 2));
+  intptr_t new_cid = new_class->id()->value();
+  intptr_t new_slots = slot_map->Size();
+  intptr_t new_heap_size =
+      AllocationSize(new_slots * sizeof(Object) + sizeof(HeapObject::Layout));
+  intptr_t old_heap_size = obj->HeapSize();
+  intptr_t old_slots =
+      (old_heap_size - sizeof(HeapObject::Layout)) / sizeof(Object);
+  const intptr_t header_slots = sizeof(HeapObject::Layout) / sizeof(uword);
+  RegularObject old_obj = static_cast<RegularObject>(obj);
+  Object nil = interpreter_->nil_obj();
+
+  static constexpr intptr_t kMaxInPlaceSlots = 64;
+  if ((new_heap_size <= old_heap_size) && (old_slots <= kMaxInPlaceSlots)) {
+    Object saved[kMaxInPlaceSlots];
+    for (intptr_t j = 0; j < old_slots; j++) {
+      saved[j] = old_obj->slot(j);
+    }
+    for (intptr_t j = 0; j < new_slots; j++) {
+      intptr_t old_index =
+          static_cast<SmallInteger>(slot_map->element(j))->value();
+      old_obj->set_slot(j, old_index == 0 ? nil : saved[old_index - 1]);
+    }
+    if (((header_slots + new_slots) & 1) == 1) {
+      old_obj->set_slot(new_slots, SmallInteger::New(0), kNoBarrier);
+    }
+    obj->set_cid(new_cid);
+    obj->set_heap_size(new_heap_size);
+    ASSERT(obj->HeapSize() == new_heap_size);
+
+    intptr_t free_size = old_heap_size - new_heap_size;
+    if (free_size != 0) {
+      HeapObject filler = HeapObject::Initialize(obj->Addr() + new_heap_size,
+                                                 kFreeListElementCid,
+                                                 free_size);
+      if (filler->heap_size() == 0) {
+        static_cast<FreeListElement>(filler)->set_overflow_size(free_size);
+      }
+      ASSERT(filler->HeapSize() == free_size);
+    }
+    return obj;
+  }
+
+  uword addr;
+  if (new_heap_size >= kLargeAllocation) {
+    addr = AllocateOldLarge(new_heap_size, kForceGrowth);
+  } else {
+    addr = AllocateOldSmall(new_heap_size, kForceGrowth);
+  }
+  RegularObject result = static_cast<RegularObject>(
+      HeapObject::Initialize(addr, new_cid, new_heap_size));
+  result->set_header_hash(obj->header_hash());
+  for (intptr_t j = 0; j < new_slots; j++) {
+    intptr_t old_index =
+        static_cast<SmallInteger>(slot_map->element(j))->value();
+    result->set_slot(j, old_index == 0 ? nil : old_obj->slot(old_index - 1));
+  }
+  if (((header_slots + new_slots) & 1) == 1) {
+    result->set_slot(new_slots, SmallInteger::New(0), kNoBarrier);
+  }
+  if (new_class->IsNewObject() && !result->is_remembered()) {
+    AddToRememberedSet(result);
+  }
+
+  HeapObject::Initialize(obj->Addr(), kForwardingCorpseCid, old_heap_size);
+  ForwardingCorpse corpse = static_cast<ForwardingCorpse>(obj);
+  if (corpse->heap_size() == 0) {
+    corpse->set_overflow_size(old_heap_size);
+  }
+  ASSERT(corpse->HeapSize() == old_heap_size);
+  corpse->set_target(result);
+  has_forwarders_ = true;
+  return result;
+}
+
+void Heap::MigratePending(intptr_t budget) {
+  while ((pending_size_ > 0) && (budget > 0)) {
+    HeapObject obj = pending_[--pending_size_];
+    if (IsMigratingCid(obj->cid())) {
+      Migrate(obj);
+      budget--;
+    }
+  }
+  if ((migrating_cids_ != nullptr) && (pending_size_ == 0)) {
+    EndMigration();
+  }
+}
+
+void Heap::MigrateSome() {
+  MigratePending(kMigrationsPerMessage);
+}
+
+void Heap::FinishMigration() {
+  MigratePending(pending_size_);
+  if (has_forwarders_) {
+    MarkSweep(kPrimitive);
+  }
+}
+
 intptr_t Heap::AllocateClassId() {
+  if ((class_table_free_ == 0) &&
+      (class_table_size_ == class_table_capacity_)) {
+    if (ShouldCollectClassTable()) {
+      class_table_collections_++;
+      if (TRACE_GROWTH) {
+        OS::PrintErr("Collecting to free class table entries (%" Pd ")\n",
+                     class_table_collections_);
+      }
+      CollectAll(kClassTable);
+    }
+    if (class_table_free_ == 0) {
+      GrowClassTable();
+    }
+  }
+
   intptr_t cid;
   if (class_table_free_ != 0) {
     cid = class_table_free_;
     class_table_free_ =
         static_cast<SmallInteger>(class_table_[cid])->value();
-  } else if (class_table_size_ == class_table_capacity_) {
-    if (TRACE_GROWTH) {
-      OS::PrintErr("Scavenging to free class table entries\n");
-    }
-    CollectAll(kClassTable);
-    if (class_table_free_ != 0) {
-      cid = class_table_free_;
-      class_table_free_ =
-          static_cast<SmallInteger>(class_table_[cid])->value();
-    } else {
-      class_table_capacity_ += (class_table_capacity_ >> 1);
-      if (TRACE_GROWTH) {
-        OS::PrintErr("Growing class table to %" Pd "\n",
-                     class_table_capacity_);
-      }
-      Object* old_class_table = class_table_;
-      class_table_ = new Object[class_table_capacity_];
-      for (intptr_t i = 0; i < class_table_size_; i++) {
-        class_table_[i] = old_class_table[i];
-      }
-#if defined(DEBUG)
-      for (intptr_t i = class_table_size_; i < class_table_capacity_; i++) {
-        class_table_[i] = static_cast<Object>(kUnallocatedWord);
-      }
-#endif
-      delete[] old_class_table;
-      cid = class_table_size_;
-      class_table_size_++;
-    }
   } else {
+    ASSERT(class_table_size_ < class_table_capacity_);
     cid = class_table_size_;
     class_table_size_++;
   }
@@ -1281,6 +2028,46 @@ intptr_t Heap::AllocateClassId() {
   return cid;
 }
 
+bool Heap::ShouldCollectClassTable() {
+  // Free ids are also reclaimed by ordinary scavenges and mark-sweeps, so only
+  // force a collection when growing would exceed the cap, or when the last
+  // mark-sweep found much of the table dead, suggesting a collection now would
+  // be productive.
+  intptr_t new_capacity = class_table_capacity_ + (class_table_capacity_ >> 1);
+  if (new_capacity > class_table_limit_) {
+    return true;
+  }
+  return class_table_freed_ > (class_table_size_ >> 2);
+}
+
+void Heap::GrowClassTable() {
+  class_table_capacity_ += (class_table_capacity_ >> 1);
+  class_table_growths_++;
+  if (TRACE_GROWTH) {
+    OS::PrintErr("Growing class table to %" Pd "\n",
+                 class_table_capacity_);
+  }
+  Object* old_class_table = class_table_;
+  class_table_ = new Object[class_table_capacity_];
+  for (intptr_t i = 0; i < class_table_size_; i++) {
+    class_table_[i] = old_class_table[i];
+  }
+#if defined(DEBUG)
+  for (intptr_t i = class_table_size_; i < class_table_capacity_; i++) {
+    class_table_[i] = static_cast<Object>(kUnallocatedWord);
+  }
+#endif
+  delete[] old_class_table;
+
+  if (migrating_cids_ != nullptr) {
+    uint8_t* old_migrating_cids = migrating_cids_;
+    migrating_cids_ = new uint8_t[class_table_capacity_];
+    memset(migrating_cids_, 0, class_table_capacity_);
+    memcpy(migrating_cids_, old_migrating_cids, class_table_size_);
+    delete[] old_migrating_cids;
+  }
+}
+
 void Heap::InitializeAfterSnapshot() {
   // Classes are registered before they are known to have been initialized, so
   // we have to delay setting the ids in the class objects or risk them being
@@ -1363,6 +2150,7 @@ static intptr_t CollectInstancesOf(intptr_t cursor,
 }
 
 Array Heap::InstancesOf(Behavior cls) {
+  FinishMigration();
   if (cls->id() == interpreter_->nil_obj()) {
     // Class not yet registered: no instance has been allocated.
     return AllocateArray(0);  // SAFEPOINT.
@@ -1372,6 +2160,12 @@ Array Heap::InstancesOf(Behavior cls) {
 
   intptr_t count = CountInstancesOf(0, cid,
                                     to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    count = CountInstancesOf(count, cid,
+                             region->young_object(), region->object_end());
+  }
   for (Region* region = regions_; region != nullptr; region = region->next()) {
     count = CountInstancesOf(count, cid,
                              region->object_start(), region->object_end());
@@ -1387,6 +2181,12 @@ Array Heap::InstancesOf(Behavior cls) {
 
   intptr_t cursor = CollectInstancesOf(0, result, cid,
                                        to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    cursor = CollectInstancesOf(cursor, result, cid,
+                                region->young_object(), region->object_end());
+  }
   for (Region* region = regions_; region != nullptr; region = region->next()) {
     cursor = CollectInstancesOf(cursor, result, cid,
                                 region->object_start(), region->object_end());
@@ -1446,9 +2246,16 @@ static intptr_t CollectReferencesTo(intptr_t cursor,
 }
 
 Array Heap::ReferencesTo(Object target) {
+  FinishMigration();
   // TODO(rmacnak): Consider reifying activations in case they refer to target.
   intptr_t count = CountReferencesTo(0, target,
                                      to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    count = CountReferencesTo(count, target,
+                              region->young_object(), region->object_end());
+  }
   for (Region* region = regions_; region != nullptr; region = region->next()) {
     count = CountReferencesTo(count, target,
                               region->object_start(), region->object_end());
@@ -1465,6 +2272,12 @@ Array Heap::ReferencesTo(Object target) {
 
   intptr_t cursor = CollectReferencesTo(0, result, target,
                                         to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    cursor = CollectReferencesTo(cursor, result, target,
+                                 region->young_object(), region->object_end());
+  }
   for (Region* region = regions_; region != nullptr; region = region->next()) {
     cursor = CollectReferencesTo(cursor, result, target,
                                  region->object_start(), region->object_end());
@@ -1476,6 +2289,367 @@ Array Heap::ReferencesTo(Object target) {
   return result;
 }
 
+// An open-addressed map from objects to the index at which each was first
+// added, for testing every object or pointer in a heap walk against many
+// objects at once.
+class ObjectIndexTable {
+ public:
+  explicit ObjectIndexTable(intptr_t size) {
+    intptr_t capacity = 16;
+    while (capacity < 2 * size) {
+      capacity <<= 1;
+    }
+    mask_ = capacity - 1;
+    entries_ = reinterpret_cast<Entry*>(malloc(capacity * sizeof(Entry)));
+    if (entries_ == nullptr) {
+      FATAL("Failed to allocate object table\n");
+    }
+    Clear();
+  }
+  ~ObjectIndexTable() { free(entries_); }
+
+  void Clear() {
+    for (intptr_t i = 0; i <= mask_; i++) {
+      entries_[i].index = -1;
+    }
+  }
+
+  void Add(Object key, intptr_t index) {
+    intptr_t i = Hash(key) & mask_;
+    while (entries_[i].index != -1) {
+      if (entries_[i].key == key) {
+        return;
+      }
+      i = (i + 1) & mask_;
+    }
+    entries_[i].key = key;
+    entries_[i].index = index;
+  }
+
+  intptr_t Lookup(Object key) const {
+    intptr_t i = Hash(key) & mask_;
+    while (entries_[i].index != -1) {
+      if (entries_[i].key == key) {
+        return entries_[i].index;
+      }
+      i = (i + 1) & mask_;
+    }
+    return -1;
+  }
+
+ private:
+  struct Entry {
+    Object key;
+    intptr_t index;  // -1 if empty.
+  };
+
+  static intptr_t Hash(Object key) {
+    uword raw = static_cast<uword>(key);
+    return static_cast<intptr_t>((raw >> kObjectAlignmentLog2) ^ raw);
+  }
+
+  Entry* entries_;
+  intptr_t mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(ObjectIndexTable);
+};
+
+template <typename T>
+static T* AllocateZeroed(intptr_t length) {
+  T* result = reinterpret_cast<T*>(calloc(length > 0 ? length : 1, sizeof(T)));
+  if (result == nullptr) {
+    FATAL("Failed to allocate %" Pd " table entries\n", length);
+  }
+  return result;
+}
+
+// The answer to a batched query has one array per queried object. Entries
+// that repeat an earlier one share its array, filled in by FinishResults.
+static void InitializeResults(Array results) {
+  for (intptr_t i = 0; i < results->Size(); i++) {
+    results->set_element(i, SmallInteger::New(0), kNoBarrier);
+  }
+}
+
+static void FinishResults(Array results,
+                          const intptr_t* first_index,
+                          const intptr_t* cursors) {
+  for (intptr_t i = 0; i < results->Size(); i++) {
+    if (first_index[i] == i) {
+      Truncate(static_cast<Array>(results->element(i)), cursors[i]);
+    } else {
+      results->set_element(i, results->element(first_index[i]));
+    }
+  }
+}
+
+static void CountInstancesOfAll(intptr_t* counts,
+                                const intptr_t* index_of_cid,
+                                intptr_t num_cids,
+                                uword start,
+                                uword end) {
+  uword scan = start;
+  while (scan < end) {
+    HeapObject obj = HeapObject::FromAddr(scan);
+    intptr_t cid = obj->cid();
+    if ((cid < num_cids) && (index_of_cid[cid] != -1)) {
+      counts[index_of_cid[cid]]++;
+    }
+    scan += obj->HeapSize();
+  }
+}
+
+static void CollectInstancesOfAll(Array results,
+                                  intptr_t* cursors,
+                                  const intptr_t* index_of_cid,
+                                  intptr_t num_cids,
+                                  const ObjectIndexTable& excluded,
+                                  uword start,
+                                  uword end) {
+  uword scan = start;
+  while (scan < end) {
+    HeapObject obj = HeapObject::FromAddr(scan);
+    intptr_t cid = obj->cid();
+    if ((cid < num_cids) && (index_of_cid[cid] != -1) &&
+        ((cid != kArrayCid) || (excluded.Lookup(obj) == -1))) {
+      intptr_t index = index_of_cid[cid];
+      Array instances = static_cast<Array>(results->element(index));
+      ASSERT(cursors[index] < instances->Size());
+      instances->set_element(cursors[index]++, obj);
+    }
+    scan += obj->HeapSize();
+  }
+}
+
+Array Heap::InstancesOfAll(Array classes) {
+  FinishMigration();
+  intptr_t num_classes = classes->Size();
+  intptr_t num_cids = class_table_size_;
+  intptr_t* index_of_cid = AllocateZeroed<intptr_t>(num_cids);
+  for (intptr_t cid = 0; cid < num_cids; cid++) {
+    index_of_cid[cid] = -1;
+  }
+  intptr_t* first_index = AllocateZeroed<intptr_t>(num_classes);
+  for (intptr_t i = 0; i < num_classes; i++) {
+    Object id = static_cast<Behavior>(classes->element(i))->id();
+    first_index[i] = i;
+    if (id->IsSmallInteger()) {
+      intptr_t cid = static_cast<SmallInteger>(id)->value();
+      if (index_of_cid[cid] == -1) {
+        index_of_cid[cid] = i;
+      } else {
+        first_index[i] = index_of_cid[cid];
+      }
+    }
+    // Otherwise the class is not yet registered and has no instances.
+  }
+
+  intptr_t* counts = AllocateZeroed<intptr_t>(num_classes);
+  CountInstancesOfAll(counts, index_of_cid, num_cids,
+                      to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    CountInstancesOfAll(counts, index_of_cid, num_cids,
+                        region->young_object(), region->object_end());
+  }
+  for (Region* region = regions_; region != nullptr; region = region->next()) {
+    CountInstancesOfAll(counts, index_of_cid, num_cids,
+                        region->object_start(), region->object_end());
+  }
+
+  if (TEST_SLOW_PATH) {
+    for (intptr_t i = 0; i < num_classes; i++) {
+      counts[i]++;  // Ensure truncation is needed.
+    }
+  }
+  Array results = AllocateArray(num_classes);  // SAFEPOINT
+  InitializeResults(results);
+  {
+    HandleScope h1(this, reinterpret_cast<Object*>(&results));
+    for (intptr_t i = 0; i < num_classes; i++) {
+      if (first_index[i] == i) {
+        Array instances = AllocateArray(counts[i]);  // SAFEPOINT
+        results->set_element(i, instances);
+      }
+    }
+  }
+
+  // The result arrays are themselves instances of Array.
+  ObjectIndexTable excluded(num_classes + 1);
+  excluded.Add(results, 0);
+  for (intptr_t i = 0; i < num_classes; i++) {
+    excluded.Add(results->element(i), i);
+  }
+
+  intptr_t* cursors = AllocateZeroed<intptr_t>(num_classes);
+  CollectInstancesOfAll(results, cursors, index_of_cid, num_cids, excluded,
+                        to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    CollectInstancesOfAll(results, cursors, index_of_cid, num_cids, excluded,
+                          region->young_object(), region->object_end());
+  }
+  for (Region* region = regions_; region != nullptr; region = region->next()) {
+    CollectInstancesOfAll(results, cursors, index_of_cid, num_cids, excluded,
+                          region->object_start(), region->object_end());
+  }
+
+  // There may be fewer instances than we initially counted if allocating the
+  // result arrays triggered a GC.
+  FinishResults(results, first_index, cursors);
+
+  free(index_of_cid);
+  free(first_index);
+  free(counts);
+  free(cursors);
+  return results;
+}
+
+static void CountReferencesToAll(intptr_t* counts,
+                                 uword* last_referrer,
+                                 const ObjectIndexTable& targets,
+                                 const ObjectIndexTable& excluded,
+                                 uword start,
+                                 uword end) {
+  uword scan = start;
+  while (scan < end) {
+    HeapObject obj = HeapObject::FromAddr(scan);
+    if ((obj->cid() >= kFirstLegalCid) &&
+        (!obj->IsArray() || (excluded.Lookup(obj) == -1))) {
+      Object* from;
+      Object* to;
+      obj->Pointers(&from, &to);
+      for (Object* ptr = from; ptr <= to; ptr++) {
+        intptr_t index = targets.Lookup(*ptr);
+        if ((index != -1) && (last_referrer[index] != scan)) {
+          last_referrer[index] = scan;
+          counts[index]++;
+        }
+      }
+    }
+    scan += obj->HeapSize();
+  }
+}
+
+static void CollectReferencesToAll(Array results,
+                                   intptr_t* cursors,
+                                   uword* last_referrer,
+                                   const ObjectIndexTable& targets,
+                                   const ObjectIndexTable& excluded,
+                                   uword start,
+                                   uword end) {
+  uword scan = start;
+  while (scan < end) {
+    HeapObject obj = HeapObject::FromAddr(scan);
+    if ((obj->cid() >= kFirstLegalCid) &&
+        (!obj->IsArray() || (excluded.Lookup(obj) == -1))) {
+      Object* from;
+      Object* to;
+      obj->Pointers(&from, &to);
+      for (Object* ptr = from; ptr <= to; ptr++) {
+        intptr_t index = targets.Lookup(*ptr);
+        if ((index != -1) && (last_referrer[index] != scan)) {
+          last_referrer[index] = scan;
+          Array referrers = static_cast<Array>(results->element(index));
+          ASSERT(cursors[index] < referrers->Size());
+          referrers->set_element(cursors[index]++, obj);
+        }
+      }
+    }
+    scan += obj->HeapSize();
+  }
+}
+
+Array Heap::ReferencesToAll(Array targets) {
+  FinishMigration();
+  // TODO(rmacnak): Consider reifying activations in case they refer to target.
+  intptr_t num_targets = targets->Size();
+  ObjectIndexTable target_table(num_targets);
+  intptr_t* first_index = AllocateZeroed<intptr_t>(num_targets);
+  for (intptr_t i = 0; i < num_targets; i++) {
+    target_table.Add(targets->element(i), i);
+    first_index[i] = target_table.Lookup(targets->element(i));
+  }
+  // The query's own arrays are not interesting referrers.
+  ObjectIndexTable excluded(num_targets + 2);
+  excluded.Add(targets, 0);
+
+  intptr_t* counts = AllocateZeroed<intptr_t>(num_targets);
+  uword* last_referrer = AllocateZeroed<uword>(num_targets);
+  CountReferencesToAll(counts, last_referrer, target_table, excluded,
+                       to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    CountReferencesToAll(counts, last_referrer, target_table, excluded,
+                         region->young_object(), region->object_end());
+  }
+  for (Region* region = regions_; region != nullptr; region = region->next()) {
+    CountReferencesToAll(counts, last_referrer, target_table, excluded,
+                         region->object_start(), region->object_end());
+  }
+
+  if (TEST_SLOW_PATH) {
+    for (intptr_t i = 0; i < num_targets; i++) {
+      counts[i]++;  // Ensure truncation is needed.
+    }
+  }
+  Array results;
+  {
+    HandleScope h1(this, reinterpret_cast<Object*>(&targets));
+    results = AllocateArray(num_targets);  // SAFEPOINT
+    InitializeResults(results);
+    HandleScope h2(this, reinterpret_cast<Object*>(&results));
+    for (intptr_t i = 0; i < num_targets; i++) {
+      if (first_index[i] == i) {
+        Array referrers = AllocateArray(counts[i]);  // SAFEPOINT
+        results->set_element(i, referrers);
+      }
+    }
+  }
+
+  // Allocating the result arrays may have moved the targets.
+  target_table.Clear();
+  for (intptr_t i = 0; i < num_targets; i++) {
+    target_table.Add(targets->element(i), i);
+  }
+  excluded.Clear();
+  excluded.Add(targets, 0);
+  excluded.Add(results, 0);
+  for (intptr_t i = 0; i < num_targets; i++) {
+    excluded.Add(results->element(i), i);
+  }
+
+  intptr_t* cursors = AllocateZeroed<intptr_t>(num_targets);
+  memset(last_referrer, 0, num_targets * sizeof(uword));
+  CollectReferencesToAll(results, cursors, last_referrer, target_table,
+                         excluded, to_.object_start(), top_);
+  for (Region* region = young_large_;
+       region != nullptr;
+       region = region->next()) {
+    CollectReferencesToAll(results, cursors, last_referrer, target_table,
+                           excluded,
+                           region->young_object(), region->object_end());
+  }
+  for (Region* region = regions_; region != nullptr; region = region->next()) {
+    CollectReferencesToAll(results, cursors, last_referrer, target_table,
+                           excluded,
+                           region->object_start(), region->object_end());
+  }
+
+  // There may be fewer referrers than we initially counted if allocating the
+  // result arrays triggered a GC.
+  FinishResults(results, first_index, cursors);
+
+  free(first_index);
+  free(counts);
+  free(last_referrer);
+  free(cursors);
+  return results;
+}
+
 uword FreeList::TryAllocate(intptr_t size) {
   intptr_t index = IndexForSize(size);
   while (index < kSizeClasses) {
@@ -5,10 +5,13 @@
 #ifndef VM_HEAP_H_
 #define VM_HEAP_H_
 
+#include <atomic>
+
 #include "vm/assert.h"
 #include "vm/flags.h"
 #include "vm/globals.h"
 #include "vm/object.h"
+#include "vm/shared_graph.h"
 #include "vm/utils.h"
 #include "vm/virtual_memory.h"
 
@@ -98,6 +101,26 @@ class FreeList {
   FreeListElement free_lists_[kSizeClasses + 1];
 };
 
+// Sizing for one isolate's heap. Zero selects the default.
+struct HeapLimits {
+  HeapLimits()
+      : initial_semispace_capacity(0),
+        max_semispace_capacity(0),
+        old_space_ceiling(0),
+        class_table_limit(0) {}
+
+  size_t initial_semispace_capacity;
+  size_t max_semispace_capacity;
+  // Old-space collects more often rather than grow past this, as it does near
+  // the process's memory limit. Once live data alone exceeds it, a full
+  // collection runs after every two regions of promotion. The heap warns
+  // when that starts rather than failing.
+  size_t old_space_ceiling;
+  // Beyond this many class ids, a full collection is tried to free ids before
+  // the class table grows further. The table still grows if none are freed.
+  intptr_t class_table_limit;
+};
+
 // C. J. Cheney. "A nonrecursive list compacting algorithm." Communications of
 // the ACM. 1970.
 //
@@ -106,9 +129,18 @@ class FreeList {
 class Heap {
  private:
   static constexpr intptr_t kLargeAllocation = 32 * KB;
+  static constexpr size_t kMinSemispaceCapacity = 64 * KB;
   static constexpr size_t kInitialSemispaceCapacity = sizeof(uword) * MB / 8;
-  static constexpr size_t kMaxSemispaceCapacity = 2 * sizeof(uword) * MB;
+  static constexpr size_t kDefaultMaxSemispaceCapacity = 2 * sizeof(uword) * MB;
+  // Bound on the configurable maximum.
+  static constexpr size_t kMaxSemispaceCapacity = 64 * sizeof(uword) * MB;
+  static constexpr int64_t kDefaultScavengePauseTarget =
+      2 * kNanosecondsPerMillisecond;
   static constexpr size_t kRegionSize = 256 * KB;
+  static constexpr intptr_t kInitialClassTableCapacity = 1024;
+  static constexpr intptr_t kDefaultClassTableLimit = 64 * KB;
+  // Instances migrated by MigrateSome.
+  static constexpr intptr_t kMigrationsPerMessage = 4096;
 
  public:
   enum Allocator { kNormal, kSnapshot };
@@ -137,9 +169,12 @@ class Heap {
     return nullptr;
   }
 
-  Heap();
+  explicit Heap(const HeapLimits& limits = HeapLimits());
   ~Heap();
 
+  // Semispace capacities must be powers of two within the supported range.
+  static bool IsValid(const HeapLimits& limits);
+
   void AddToRememberedSet(HeapObject object) {
     ASSERT(object->IsOldObject());
     ASSERT(!object->is_remembered());
@@ -183,6 +218,28 @@ class Heap {
     return result;
   }
 
+  // Like AllocateByteArray, but the elements are zero. Large byte arrays get
+  // fresh pages and skip clearing.
+  ByteArray AllocateZeroedByteArray(intptr_t num_bytes) {
+    const intptr_t heap_size =
+        AllocationSize(num_bytes * sizeof(uint8_t) + sizeof(ByteArray::Layout));
+    uword addr;
+    if (heap_size >= kLargeAllocation) {
+      addr = AllocateNewLarge(heap_size, true);
+    } else {
+      addr = AllocateNew(heap_size);
+    }
+    HeapObject obj = HeapObject::Initialize(addr, kByteArrayCid, heap_size);
+    ByteArray result = static_cast<ByteArray>(obj);
+    result->set_size(SmallInteger::New(num_bytes));
+    if (heap_size < kLargeAllocation) {
+      memset(result->element_addr(0), 0, num_bytes);
+    }
+    ASSERT(result->IsByteArray());
+    ASSERT(result->HeapSize() == heap_size);
+    return result;
+  }
+
   String AllocateString(intptr_t num_bytes, Allocator allocator = kNormal) {
     const intptr_t heap_size =
         AllocationSize(num_bytes * sizeof(uint8_t) + sizeof(String::Layout));
@@ -278,22 +335,66 @@ class Heap {
   Message AllocateMessage();
 
   size_t Size() const {
-    size_t new_size = top_ - to_.object_start();
+    size_t new_size = top_ - to_.object_start() + young_large_size_;
     return new_size + old_size_;
   }
 
   void CollectAll(Reason reason) { MarkSweep(reason); }
 
+  // Takes over one reference to graph. Held graphs count as old space and are
+  // released by the first mark-sweep that finds no pointer into them.
+  void HoldSharedGraph(SharedGraph* graph) {
+    if (shared_graphs_.Add(graph)) {
+      old_size_ += graph->size();
+    }
+  }
+  SharedGraph* SharedGraphOf(HeapObject obj) const {
+    return shared_graphs_.Lookup(obj);
+  }
+
   Array InstancesOf(Behavior cls);
   Array ReferencesTo(Object target);
-
-  bool BecomeForward(Array old, Array neu);
+  // Like InstancesOf and ReferencesTo for each element, but in a single pass
+  // to count and a single pass to collect however many are queried. Answers
+  // an array of arrays, one per element.
+  Array InstancesOfAll(Array classes);
+  Array ReferencesToAll(Array targets);
+
+  // migrations is nullptr or an array of triples: a migration class standing
+  // in for an old class whose instances change shape, the new class, and an
+  // array giving for each slot of the new class the 1-based index of the old
+  // slot it takes its value from, or 0 for nil. Instances of the old classes
+  // keep their class ids, which are handed over to the migration classes, and
+  // are migrated lazily (see Migrate).
+  bool BecomeForward(Array old, Array neu, Array migrations = nullptr);
+
+  // True while instances are waiting to be migrated or forwarders left by
+  // migrations may still be referenced. Objects that might be either must be
+  // passed through Resolve before their class or slots are used.
+  bool migrating() const {
+    return (migrating_cids_ != nullptr) || has_forwarders_;
+  }
+  Object Resolve(Object obj) {
+    if (!migrating()) {
+      return obj;
+    }
+    return ResolveMigrating(obj);
+  }
+  // Migrates some waiting instances. Called between messages so a large
+  // migration is spread out over idle time instead of paid for at once.
+  void MigrateSome();
+  // Migrates all waiting instances and removes any forwarders, for operations
+  // that inspect the whole heap.
+  void FinishMigration();
 
   intptr_t AllocateClassId();
   void RegisterClass(intptr_t cid, Behavior cls) {
     ASSERT((class_table_[cid] == static_cast<Object>(kUninitializedWord)) ||
            (cid == kEphemeronCid));
     class_table_[cid] = cls;
+    if (cls->IsNewObject()) {
+      AddToYoungClasses(cid);
+    }
     cls->set_id(SmallInteger::New(cid));
     cls->AssertCouldBeBehavior();
     ASSERT(cls->cid() >= kFirstRegularObjectCid);
@@ -303,6 +404,7 @@ class Heap {
     ASSERT(cid < class_table_size_);
     return static_cast<Behavior>(class_table_[cid]);
   }
+  intptr_t class_table_size() const { return class_table_size_; }
 
   void InitializeInterpreter(Interpreter* interpreter) {
     ASSERT(interpreter_ == nullptr);
@@ -315,13 +417,37 @@ class Heap {
   intptr_t handles() const { return handles_size_; }
   void set_handles(intptr_t value) { handles_size_ = value; }
 
+  // New-space grows and shrinks so scavenges take about pause_target
+  // nanoseconds, with semispaces no larger than max_capacity. Answers false
+  // unless max_capacity is a power of two, at least the initial capacity and
+  // within the supported range.
+  bool SetNewSpacePolicy(int64_t pause_target, size_t max_capacity);
+  int64_t scavenge_pause_target() const { return scavenge_pause_target_; }
+  size_t max_semispace_capacity() const { return max_semispace_capacity_; }
+  // What new-space allocation is currently limited to in each semispace.
+  size_t semispace_capacity() const { return next_semispace_capacity_; }
+
  private:
   void GrowRememberedSet();
   void ShrinkRememberedSet();
 
+  void AddToYoungClasses(intptr_t cid) {
+    if (young_classes_size_ == young_classes_capacity_) {
+      GrowYoungClasses();
+    }
+    young_classes_[young_classes_size_++] = cid;
+  }
+  void GrowYoungClasses();
+  void RebuildYoungClasses();
+
+  bool ShouldCollectClassTable();
+  void GrowClassTable();
+
   // Scavenging.
   void Scavenge(Reason reason);
   void FlipSpaces();
+  void SetSemispaceCapacity(int64_t pause, int64_t interval, size_t survived);
+  static bool IsValidSemispaceCapacity(size_t capacity);
   void ScavengeRoots();
   uword ScavengeToSpace(uword scan);
   void PushTenureStack(uword addr);
@@ -332,14 +458,33 @@ class Heap {
   void ScavengeOldObject(HeapObject obj);
   bool ScavengeClass(intptr_t cid);
 
+  // Young large objects.
+  bool IsYoungLarge(HeapObject obj) const {
+    // Only meaningful during a scavenge, when other new objects are in
+    // from-space.
+    return obj->IsNewObject() &&
+        ((obj->Addr() - from_.base()) >= from_.size());
+  }
+  bool ScavengeYoungLarge(Object* ptr);
+  void ProcessYoungLargeScanList();
+  void SweepYoungLargeScavenge();
+  void SweepYoungLargeMarkSweep();
+
   // Mark-sweep.
   void MarkSweep(Reason reason);
   void MarkRoots();
   void MarkObject(Object obj);
+  void MarkPointer(Object* ptr) {
+    SkipForwarder(ptr);
+    MarkObject(*ptr);
+  }
+  void SkipForwarder(Object* ptr);
+  bool IsMarkSweepSurvivor(Object obj) const;
   void ProcessMarkStack();
   void Sweep();
   bool SweepRegion(Region* region);
   void SetOldAllocationLimit();
+  void ReportOldSize();
 
   // Ephemerons.
   void AddToEphemeronList(Ephemeron ephemeron_corpse);
@@ -364,6 +509,25 @@ class Heap {
   void ForwardRoots();
   void ForwardHeap();
 
+  // Lazy migration.
+  void BeginMigration(Array migrations);
+  void EndMigration();
+  bool IsMigratingCid(intptr_t cid) const {
+    return (migrating_cids_ != nullptr) && (migrating_cids_[cid] != 0);
+  }
+  void AddToPending(HeapObject obj) {
+    if (pending_size_ == pending_capacity_) {
+      GrowPending();
+    }
+    pending_[pending_size_++] = obj;
+  }
+  void GrowPending();
+  void MournPendingScavenge();
+  void MournPendingMarkSweep();
+  Object ResolveMigrating(Object obj);
+  Object Migrate(HeapObject obj);
+  void MigratePending(intptr_t budget);
+
   uword TryAllocateNew(intptr_t size) {
     uword result = top_;
     intptr_t remaining = end_ - top_;
@@ -384,12 +548,13 @@ class Heap {
       return AllocateSnapshotSmall(size);
     }
     if (size >= kLargeAllocation) {
-      return AllocateOldLarge(size, kControlGrowth);
+      return AllocateNewLarge(size, false);
     }
     return AllocateNew(size);
   }
 
   uword AllocateNew(intptr_t size);
+  uword AllocateNewLarge(intptr_t size, bool zero);
   uword AllocateTenure(intptr_t size);
   uword AllocateOldSmall(intptr_t size, GrowthPolicy growth);
   uword AllocateOldLarge(intptr_t size, GrowthPolicy growth);
@@ -413,7 +578,19 @@ class Heap {
   uword survivor_end_;
   Semispace to_;
   Semispace from_;
+  // The allocation limit of to-space, and the least size of to-space after
+  // the next flip. To-space may be larger, up to four times (see FlipSpaces).
   size_t next_semispace_capacity_;
+  size_t min_semispace_capacity_;
+  size_t max_semispace_capacity_;
+  int64_t scavenge_pause_target_;
+  int64_t last_scavenge_end_;
+
+  // Young large objects, each in its own region. They are reclaimed by the
+  // scavenger without copying and promoted after surviving two scavenges.
+  Region* young_large_;
+  Region* young_large_scan_;
+  size_t young_large_size_;
 
   // Old space.
   Region* regions_;
@@ -421,6 +598,17 @@ class Heap {
   size_t old_size_;
   size_t old_capacity_;
   size_t old_limit_;
+  size_t old_space_ceiling_;
+  bool over_old_space_ceiling_;  // Warned that live data exceeds the ceiling.
+  size_t reported_old_size_;  // This heap's part of process_old_size_.
+
+  // Old-space bytes of every heap in the process, each as of its last
+  // mark-sweep or region allocation. Narrows each heap's limit toward half
+  // the memory limit.
+  static std::atomic<intptr_t> process_old_size_;
+
+  // Graphs outside the heap that its objects may point into.
+  SharedGraphTable shared_graphs_;
 
   // Remembered set.
   HeapObject* remembered_set_;
@@ -431,7 +619,17 @@ class Heap {
   Object* class_table_;
   intptr_t class_table_size_;
   intptr_t class_table_capacity_;
+  intptr_t class_table_limit_;
   intptr_t class_table_free_;
+  intptr_t class_table_freed_;  // By the last mark-sweep.
+  intptr_t class_table_collections_;
+  intptr_t class_table_growths_;
+
+  // Class ids whose classes are in new-space, so the scavenger can mourn the
+  // class table without visiting every entry.
+  intptr_t* young_classes_;
+  intptr_t young_classes_size_;
+  intptr_t young_classes_capacity_;
 
   // Roots.
   Interpreter* interpreter_;
@@ -443,6 +641,16 @@ class Heap {
   Ephemeron ephemeron_list_;
   WeakArray weak_list_;
 
+  // Lazy migration. The migrations array of the last become is a root. Class
+  // ids marked in migrating_cids_ belong to migration classes, whose instances
+  // are listed weakly in pending_ until migrated or dead.
+  Object migrations_;
+  uint8_t* migrating_cids_;
+  HeapObject* pending_;
+  intptr_t pending_size_;
+  intptr_t pending_capacity_;
+  bool has_forwarders_;
+
   DISALLOW_COPY_AND_ASSIGN(Heap);
 };
 
@@ -79,6 +79,9 @@ static void FrameActivationPut(Object* fp, Activation activation) {
 }
 
 static Object FrameReceiver(Object* fp) { return fp[-4]; }
+static void FrameReceiverPut(Object* fp, Object receiver) {
+  fp[-4] = receiver;
+}
 
 static Object FrameParameter(Object* fp, intptr_t index) {
   ASSERT(index <= FlagsNumArgs(FrameFlags(fp)));
@@ -134,7 +137,8 @@ Interpreter::Interpreter(Heap* heap, Isolate* isolate) :
     object_store_(nullptr),
     heap_(heap),
     isolate_(isolate),
-    environment_(nullptr) {
+    environment_(nullptr),
+    forwarding_depth_(0) {
   heap->InitializeInterpreter(this);
 
   stack_limit_ = reinterpret_cast<Object*>(malloc(kStackSize));
@@ -186,14 +190,14 @@ void Interpreter::PushLiteral(intptr_t offset) {
 void Interpreter::PushEnclosingObject(intptr_t depth) {
   ASSERT(depth > 0);  // Compiler should have used push receiver.
 
-  Object enclosing_object = FrameReceiver(fp_);
+  Object enclosing_object = H->Resolve(FrameReceiver(fp_));
   AbstractMixin target_mixin = FrameMethod(fp_)->mixin();
   intptr_t count = 0;
   while (count < depth) {
     count++;
     Behavior mixin_app = FindApplicationOf(target_mixin,
                                             enclosing_object->Klass(H));
-    enclosing_object = mixin_app->enclosing_object();
+    enclosing_object = H->Resolve(mixin_app->enclosing_object());
     target_mixin = target_mixin->enclosing_mixin();
   }
   Push(enclosing_object);
@@ -238,29 +242,19 @@ void Interpreter::Perform(Object message,
                           Object receiver,
                           String selector,
                           Array arguments) {
-  Behavior cls = receiver->Klass(H);
-  while (cls != nil) {
-    Method method = MethodAt(cls, selector);
-    if (method != nil) {
-      if (method->IsPublic()) {
-        intptr_t num_args = arguments->Size();
-        if (method->NumArgs() != num_args) goto DNU;
-
-        Push(receiver);
-        for (intptr_t i = 0; i < num_args; i++) {
-          Push(arguments->element(i));
-        }
-        Activate(method, num_args);  // SAFEPOINT
-        return;
-      } else if (method->IsProtected()) {
-        goto DNU;
-      }
+  receiver = H->Resolve(receiver);
+  Method method = PerformTarget(receiver, selector);
+  intptr_t num_args = arguments->Size();
+  if (method != nil && method->NumArgs() == num_args) {
+    Push(receiver);
+    for (intptr_t i = 0; i < num_args; i++) {
+      Push(arguments->element(i));
     }
-    cls = cls->superclass();
+    Activate(method, num_args);  // SAFEPOINT
+    return;
   }
 
- DNU:
-  cls = receiver->Klass(H);
+  Behavior cls = receiver->Klass(H);
   while (cls != nil) {
     Method method = MethodAt(cls, object_store()->does_not_understand());
     if (method != nil) {
@@ -275,6 +269,58 @@ void Interpreter::Perform(Object message,
   FATAL("Recursive #doesNotUnderstand:");
 }
 
+// The stack holds a selector, a receiver and num_args arguments, above the
+// slot that will take the result. Answers false, leaving the stack untouched,
+// unless the receiver publicly understands the selector with that arity, so
+// the caller can fall back to building a Message.
+bool Interpreter::PerformStacked(intptr_t num_args) {
+  String selector = static_cast<String>(Stack(num_args + 1));
+  if (!selector->IsString() || !selector->is_canonical()) {
+    return false;
+  }
+  Object receiver = H->Resolve(Stack(num_args));
+  Method method = PerformTarget(receiver, selector);
+  if (method == nil || method->NumArgs() != num_args) {
+    return false;
+  }
+
+  StackPut(num_args, receiver);
+  for (intptr_t i = num_args; i >= 0; i--) {
+    StackPut(i + 2, Stack(i));
+  }
+  Drop(2);
+  Activate(method, num_args);  // SAFEPOINT
+  return true;
+}
+
+Method Interpreter::PerformTarget(Object receiver, String selector) {
+#if LOOKUP_CACHE
+  Method target;
+  if (lookup_cache_.LookupPerform(receiver->ClassId(), selector, &target)) {
+    return target;
+  }
+#endif
+
+  Method result = static_cast<Method>(nil);
+  Behavior cls = receiver->Klass(H);
+  while (cls != nil) {
+    Method method = MethodAt(cls, selector);
+    if (method != nil) {
+      if (method->IsPublic()) {
+        result = method;
+        break;
+      } else if (method->IsProtected()) {
+        break;
+      }
+    }
+    cls = cls->superclass();
+  }
+#if LOOKUP_CACHE
+  lookup_cache_.InsertPerform(receiver->ClassId(), selector, result);
+#endif
+  return result;
+}
+
 void Interpreter::CommonSend(intptr_t offset) {
   Array common_selectors = object_store()->common_selectors();
   String selector =
@@ -319,8 +365,18 @@ void Interpreter::OrdinarySend(String selector,
 #if LOOKUP_CACHE
   Object receiver = Stack(num_args);
   Method target;
-  if (lookup_cache_.LookupOrdinary(receiver->ClassId(), selector, &target)) {
-    Activate(target, num_args);  // SAFEPOINT
+  intptr_t kind;
+  Object operand;
+  if (lookup_cache_.LookupOrdinary(receiver->ClassId(), selector,
+                                   &target, &kind, &operand)) {
+    if (kind == kActivateTarget) {
+      Activate(target, num_args);  // SAFEPOINT
+    } else if (kind >= kDNUTarget) {
+      ActivateDNU(target, kind, operand, selector, num_args, receiver,
+                  true);  // SAFEPOINT
+    } else {
+      ActivateFrameless(kind, operand, receiver, num_args + 1);
+    }
     return;
   }
 #endif
@@ -331,6 +387,10 @@ void Interpreter::OrdinarySend(String selector,
 void Interpreter::OrdinarySendMiss(String selector,
                                    intptr_t num_args) {
   Object receiver = Stack(num_args);
+  if (H->migrating()) {
+    receiver = H->Resolve(receiver);
+    StackPut(num_args, receiver);
+  }
   Behavior receiver_class = receiver->Klass(H);
   Behavior lookup_class = receiver_class;
   while (lookup_class != nil) {
@@ -338,14 +398,17 @@ void Interpreter::OrdinarySendMiss(String selector,
     if (method != nil) {
       if (method->IsPublic()) {
 #if LOOKUP_CACHE
-        lookup_cache_.InsertOrdinary(receiver->ClassId(), selector, method);
+        Object operand;
+        intptr_t kind = ClassifyTarget(method, &operand);
+        lookup_cache_.InsertOrdinary(receiver->ClassId(), selector, method,
+                                     kind, operand);
 #endif
         Activate(method, num_args);  // SAFEPOINT
         return;
       } else if (method->IsProtected()) {
         bool present_receiver = true;
         DNUSend(selector, num_args, receiver,
-                receiver_class, present_receiver);  // SAFEPOINT
+                receiver_class, present_receiver, kSelf);  // SAFEPOINT
         return;
       }
     }
@@ -353,7 +416,7 @@ void Interpreter::OrdinarySendMiss(String selector,
   }
   bool present_receiver = true;
   DNUSend(selector, num_args, receiver,
-          receiver_class, present_receiver);  // SAFEPOINT
+          receiver_class, present_receiver, kSelf);  // SAFEPOINT
 }
 
 Behavior Interpreter::FindApplicationOf(AbstractMixin mixin,
@@ -375,15 +438,26 @@ void Interpreter::SuperSend(intptr_t selector_index,
   Object receiver = FrameReceiver(fp_);
   Object absent_receiver;
   Method target;
+  intptr_t kind;
+  Object operand;
   if (lookup_cache_.LookupNS(receiver->ClassId(),
                              selector,
                              FrameMethod(fp_),
                              kSuper,
                              &absent_receiver,
-                             &target)) {
+                             &target,
+                             &kind,
+                             &operand)) {
     ASSERT(absent_receiver == nullptr);
     absent_receiver = receiver;
-    ActivateAbsent(target, receiver, num_args);  // SAFEPOINT
+    if (kind == kActivateTarget) {
+      ActivateAbsent(target, receiver, num_args);  // SAFEPOINT
+    } else if (kind >= kDNUTarget) {
+      ActivateDNU(target, kind, operand, selector, num_args, receiver,
+                  false);  // SAFEPOINT
+    } else {
+      ActivateFrameless(kind, operand, receiver, num_args);
+    }
     return;
   }
 #endif
@@ -393,7 +467,7 @@ void Interpreter::SuperSend(intptr_t selector_index,
 
 void Interpreter::SuperSendMiss(String selector,
                                 intptr_t num_args) {
-  Object receiver = FrameReceiver(fp_);
+  Object receiver = ResolveFrameReceiver();
   AbstractMixin method_mixin = FrameMethod(fp_)->mixin();
   Behavior receiver_class = receiver->Klass(H);
   Behavior method_mixin_app = FindApplicationOf(method_mixin,
@@ -413,16 +487,27 @@ void Interpreter::ImplicitReceiverSend(intptr_t selector_index,
   Object method_receiver = FrameReceiver(fp_);
   Object absent_receiver;
   Method target;
+  intptr_t kind;
+  Object operand;
   if (lookup_cache_.LookupNS(method_receiver->ClassId(),
                              selector,
                              FrameMethod(fp_),
                              kImplicitReceiver,
                              &absent_receiver,
-                             &target)) {
+                             &target,
+                             &kind,
+                             &operand)) {
     if (absent_receiver == nullptr) {
       absent_receiver = method_receiver;
     }
-    ActivateAbsent(target, absent_receiver, num_args);  // SAFEPOINT
+    if (kind == kActivateTarget) {
+      ActivateAbsent(target, absent_receiver, num_args);  // SAFEPOINT
+    } else if (kind >= kDNUTarget) {
+      ActivateDNU(target, kind, operand, selector, num_args, absent_receiver,
+                  false);  // SAFEPOINT
+    } else {
+      ActivateFrameless(kind, operand, absent_receiver, num_args);
+    }
     return;
   }
 #endif
@@ -432,7 +517,7 @@ void Interpreter::ImplicitReceiverSend(intptr_t selector_index,
 
 void Interpreter::ImplicitReceiverSendMiss(String selector,
                                            intptr_t num_args) {
-  Object method_receiver = FrameReceiver(fp_);
+  Object method_receiver = ResolveFrameReceiver();
 
   Object candidate_receiver = method_receiver;
   AbstractMixin candidate_mixin = FrameMethod(fp_)->mixin();
@@ -451,7 +536,8 @@ void Interpreter::ImplicitReceiverSendMiss(String selector,
     }
     candidate_mixin = candidate_mixin->enclosing_mixin();
     if (candidate_mixin == nil) break;
-    candidate_receiver = candidateMixinApplication->enclosing_object();
+    candidate_receiver =
+        H->Resolve(candidateMixinApplication->enclosing_object());
   }
   ProtectedSend(selector,
                 num_args,
@@ -469,14 +555,25 @@ void Interpreter::OuterSend(intptr_t selector_index,
   Object receiver = FrameReceiver(fp_);
   Object absent_receiver;
   Method target;
+  intptr_t kind;
+  Object operand;
   if (lookup_cache_.LookupNS(receiver->ClassId(),
                              selector,
                              FrameMethod(fp_),
                              depth,
                              &absent_receiver,
-                             &target)) {
+                             &target,
+                             &kind,
+                             &operand)) {
     ASSERT(absent_receiver != nullptr);
-    ActivateAbsent(target, absent_receiver, num_args);  // SAFEPOINT
+    if (kind == kActivateTarget) {
+      ActivateAbsent(target, absent_receiver, num_args);  // SAFEPOINT
+    } else if (kind >= kDNUTarget) {
+      ActivateDNU(target, kind, operand, selector, num_args, absent_receiver,
+                  false);  // SAFEPOINT
+    } else {
+      ActivateFrameless(kind, operand, absent_receiver, num_args);
+    }
     return;
   }
 #endif
@@ -487,14 +584,14 @@ void Interpreter::OuterSend(intptr_t selector_index,
 void Interpreter::OuterSendMiss(String selector,
                                 intptr_t num_args,
                                 intptr_t depth) {
-  Object receiver = FrameReceiver(fp_);
+  Object receiver = ResolveFrameReceiver();
   AbstractMixin target_mixin = FrameMethod(fp_)->mixin();
   intptr_t count = 0;
   while (count < depth) {
     count++;
     Behavior mixin_app = FindApplicationOf(target_mixin,
                                             receiver->Klass(H));
-    receiver = mixin_app->enclosing_object();
+    receiver = H->Resolve(mixin_app->enclosing_object());
     target_mixin = target_mixin->enclosing_mixin();
   }
   LexicalSend(selector, num_args, receiver, target_mixin, depth);  // SAFEPOINT
@@ -508,14 +605,25 @@ void Interpreter::SelfSend(intptr_t selector_index,
   Object receiver = FrameReceiver(fp_);
   Object absent_receiver;
   Method target;
+  intptr_t kind;
+  Object operand;
   if (lookup_cache_.LookupNS(receiver->ClassId(),
                              selector,
                              FrameMethod(fp_),
                              kSelf,
                              &absent_receiver,
-                             &target)) {
+                             &target,
+                             &kind,
+                             &operand)) {
     ASSERT(absent_receiver == nullptr);
-    ActivateAbsent(target, receiver, num_args);  // SAFEPOINT
+    if (kind == kActivateTarget) {
+      ActivateAbsent(target, receiver, num_args);  // SAFEPOINT
+    } else if (kind >= kDNUTarget) {
+      ActivateDNU(target, kind, operand, selector, num_args, receiver,
+                  false);  // SAFEPOINT
+    } else {
+      ActivateFrameless(kind, operand, receiver, num_args);
+    }
     return;
   }
 #endif
@@ -525,11 +633,23 @@ void Interpreter::SelfSend(intptr_t selector_index,
 
 void Interpreter::SelfSendMiss(String selector,
                                intptr_t num_args) {
-  Object receiver = FrameReceiver(fp_);
+  Object receiver = ResolveFrameReceiver();
   AbstractMixin method_mixin = FrameMethod(fp_)->mixin();
   LexicalSend(selector, num_args, receiver, method_mixin, kSelf);  // SAFEPOINT
 }
 
+// The receiver of the current frame may be an instance waiting to migrate to a
+// new shape (see Heap::Resolve). Sends that miss resolve it for the rest of the
+// activation, so the lookup cache never sees an unmigrated receiver.
+Object Interpreter::ResolveFrameReceiver() {
+  Object receiver = FrameReceiver(fp_);
+  if (H->migrating()) {
+    receiver = H->Resolve(receiver);
+    FrameReceiverPut(fp_, receiver);
+  }
+  return receiver;
+}
+
 void Interpreter::LexicalSend(String selector,
                               intptr_t num_args,
                               Object receiver,
@@ -540,13 +660,17 @@ void Interpreter::LexicalSend(String selector,
   Method method = MethodAt(mixin_application, selector);
   if (method != nil && method->IsPrivate()) {
 #if LOOKUP_CACHE
+    Object operand;
+    intptr_t kind = ClassifyTarget(method, &operand);
     Object method_receiver = FrameReceiver(fp_);
     lookup_cache_.InsertNS(method_receiver->ClassId(),
                            selector,
                            FrameMethod(fp_),
                            rule,
                            receiver == method_receiver ? Object() : receiver,
-                           method);
+                           method,
+                           kind,
+                           operand);
 #endif
     ActivateAbsent(method, receiver, num_args);  // SAFEPOINT
     return;
@@ -565,13 +689,17 @@ void Interpreter::ProtectedSend(String selector,
     Method method = MethodAt(lookup_class, selector);
     if (method != nil && !method->IsPrivate()) {
 #if LOOKUP_CACHE
+      Object operand;
+      intptr_t kind = ClassifyTarget(method, &operand);
       Object method_receiver = FrameReceiver(fp_);
       lookup_cache_.InsertNS(method_receiver->ClassId(),
                              selector,
                              FrameMethod(fp_),
                              rule,
                              receiver == method_receiver ? Object() : receiver,
-                             method);
+                             method,
+                             kind,
+                             operand);
 #endif
       ActivateAbsent(method, receiver, num_args);  // SAFEPOINT
       return;
@@ -580,24 +708,16 @@ void Interpreter::ProtectedSend(String selector,
   }
   bool present_receiver = false;
   DNUSend(selector, num_args, receiver, mixin_application,
-          present_receiver);  // SAFEPOINT
+          present_receiver, rule);  // SAFEPOINT
 }
 
+// An absent receiver's rule is that of the send, for caching the handler.
 void Interpreter::DNUSend(String selector,
                           intptr_t num_args,
                           Object receiver,
                           Behavior lookup_class,
-                          bool present_receiver) {
-  if (TRACE_DNU) {
-    char* c1 = receiver->ToCString(H);
-    char* c2 = selector->ToCString(H);
-    char* c3 = FrameMethod(fp_)->selector()->ToCString(H);
-    OS::PrintErr("DNU %s %s from %s\n", c1, c2, c3);
-    free(c1);
-    free(c2);
-    free(c3);
-  }
-
+                          bool present_receiver,
+                          intptr_t rule) {
   Behavior cls = lookup_class;
   Method method;
   do {
@@ -612,6 +732,84 @@ void Interpreter::DNUSend(String selector,
     FATAL("Recursive #doesNotUnderstand:");
   }
 
+  Object operand;
+  intptr_t kind = ClassifyDNU(method, receiver, &operand);
+#if LOOKUP_CACHE
+  if (present_receiver) {
+    lookup_cache_.InsertOrdinary(receiver->ClassId(), selector, method,
+                                 kind, operand);
+  } else {
+    Object method_receiver = FrameReceiver(fp_);
+    lookup_cache_.InsertNS(method_receiver->ClassId(),
+                           selector,
+                           FrameMethod(fp_),
+                           rule,
+                           receiver == method_receiver ? Object() : receiver,
+                           method,
+                           kind,
+                           operand);
+  }
+#endif
+  ActivateDNU(method, kind, operand, selector, num_args, receiver,
+              present_receiver);  // SAFEPOINT
+}
+
+// A Forwarder's doesNotUnderstand: is marked by its primitive. Its target is
+// the first slot after those of the class its mixin is applied to.
+intptr_t Interpreter::ClassifyDNU(Method method,
+                                  Object receiver,
+                                  Object* operand) {
+  if (!Primitives::IsForwarder(method->Primitive()) ||
+      !receiver->IsRegularObject()) {
+    return kDNUTarget;
+  }
+  Behavior receiver_class = receiver->Klass(H);
+  Behavior forwarder = FindApplicationOf(method->mixin(), receiver_class);
+  SmallInteger offset = forwarder->superclass()->format();
+  if (!offset->IsSmallInteger() ||
+      !receiver_class->format()->IsSmallInteger() ||
+      offset->value() >= receiver_class->format()->value()) {
+    return kDNUTarget;
+  }
+  *operand = offset;
+  return kForwardTarget;
+}
+
+// Forwarded sends recurse through OrdinarySend, so a chain of forwarders deeper
+// than this falls back to materializing the Message.
+static constexpr intptr_t kMaxForwardingDepth = 8;
+
+void Interpreter::ActivateDNU(Method method,
+                              intptr_t kind,
+                              Object operand,
+                              String selector,
+                              intptr_t num_args,
+                              Object receiver,
+                              bool present_receiver) {
+  if (TRACE_DNU) {
+    char* c1 = receiver->ToCString(H);
+    char* c2 = selector->ToCString(H);
+    char* c3 = FrameMethod(fp_)->selector()->ToCString(H);
+    OS::PrintErr("DNU %s %s from %s\n", c1, c2, c3);
+    free(c1);
+    free(c2);
+    free(c3);
+  }
+
+  if ((kind == kForwardTarget) && (forwarding_depth_ < kMaxForwardingDepth)) {
+    intptr_t offset = static_cast<SmallInteger>(operand)->value();
+    Object target = static_cast<RegularObject>(receiver)->slot(offset);
+    if (present_receiver) {
+      StackPut(num_args, target);
+    } else {
+      InsertAbsentReceiver(target, num_args);
+    }
+    forwarding_depth_++;
+    OrdinarySend(selector, num_args);  // SAFEPOINT
+    forwarding_depth_--;
+    return;
+  }
+
   Array arguments;
   {
     HandleScope h1(H, reinterpret_cast<Object*>(&selector));
@@ -784,6 +982,88 @@ void Interpreter::InsertAbsentReceiver(Object receiver, intptr_t num_args) {
   StackPut(num_args, receiver);
 }
 
+// Trivial methods are recognized from their header and leading bytecodes, so
+// existing snapshots benefit without being recompiled.
+intptr_t Interpreter::ClassifyTarget(Method method, Object* operand) {
+  intptr_t prim = method->Primitive();
+  if ((prim & 256) != 0) {
+    *operand = SmallInteger::New(prim & 255);
+    return kGetterTarget;
+  } else if ((prim & 512) != 0) {
+    *operand = SmallInteger::New(prim & 255);
+    return kSetterTarget;
+  } else if (prim == 200) {  // quickReturnSelf
+    return kReturnSelfTarget;
+  } else if (prim != 0) {
+    return kActivateTarget;
+  }
+
+  ByteArray bytecode = method->bytecode();
+  uint8_t byte1 = bytecode->element(0);
+  switch (byte1) {
+  case 166: *operand = nil_; return kReturnConstantTarget;
+  case 167: *operand = false_; return kReturnConstantTarget;
+  case 168: *operand = true_; return kReturnConstantTarget;
+  case 169: return kReturnSelfTarget;
+  }
+  if ((bytecode->Size() < 2) || (bytecode->element(1) != 170)) {
+    return kActivateTarget;
+  }
+  switch (byte1) {
+  case 144: case 145: case 146: case 147:
+  case 148: case 149: case 150: case 151: {
+    Array literals = method->literals();
+    intptr_t offset = byte1 & 7;
+    if (offset >= literals->Size()) {
+      return kActivateTarget;
+    }
+    *operand = literals->element(offset);
+    return kReturnConstantTarget;
+  }
+  case 152: *operand = nil_; return kReturnConstantTarget;
+  case 153: *operand = false_; return kReturnConstantTarget;
+  case 154: *operand = true_; return kReturnConstantTarget;
+  case 155: return kReturnSelfTarget;
+  case 160: case 161: case 162: case 163:
+    *operand = SmallInteger::New(byte1 - 161);
+    return kReturnConstantTarget;
+  }
+  return kActivateTarget;
+}
+
+// Answers the result of a classified target in place of the top drop stack
+// elements: the arguments, and the receiver when it is present on the stack.
+void Interpreter::ActivateFrameless(intptr_t kind,
+                                    Object operand,
+                                    Object receiver,
+                                    intptr_t drop) {
+  Object result;
+  switch (kind) {
+  case kGetterTarget: {
+    ASSERT(receiver->IsRegularObject() || receiver->IsEphemeron());
+    intptr_t offset = static_cast<SmallInteger>(operand)->value();
+    result = static_cast<RegularObject>(receiver)->slot(offset);
+    break;
+  }
+  case kSetterTarget: {
+    ASSERT(receiver->IsRegularObject() || receiver->IsEphemeron());
+    intptr_t offset = static_cast<SmallInteger>(operand)->value();
+    static_cast<RegularObject>(receiver)->set_slot(offset, Stack(0));
+    result = receiver;
+    break;
+  }
+  case kReturnSelfTarget:
+    result = receiver;
+    break;
+  case kReturnConstantTarget:
+    result = operand;
+    break;
+  default:
+    UNREACHABLE();
+  }
+  PopNAndPush(drop, result);
+}
+
 void Interpreter::ActivateAbsent(Method method,
                                  Object receiver,
                                  intptr_t num_args) {
@@ -819,6 +1099,12 @@ void Interpreter::Activate(Method method, intptr_t num_args) {
       PopNAndPush(2, receiver);
       return;
     } else {
+      if (H->migrating()) {
+        // Primitives inspect their receiver and arguments directly.
+        for (intptr_t i = 0; i <= num_args; i++) {
+          StackPut(i, H->Resolve(Stack(i)));
+        }
+      }
       HandleScope h1(H, reinterpret_cast<Object*>(&method));
       if (Primitives::Invoke(prim, num_args, H, this)) {  // SAFEPOINT
         ASSERT(StackDepth() >= 0);
@@ -1087,6 +1373,7 @@ void Interpreter::NonLocalReturn(Object result) {
 
 void Interpreter::Enter() {
   intptr_t saved_handles = H->handles();
+  intptr_t saved_forwarding_depth = forwarding_depth_;
   jmp_buf* saved_environment = environment_;
 
   jmp_buf environment;
@@ -1098,6 +1385,7 @@ void Interpreter::Enter() {
   }
 
   environment_ = saved_environment;
+  forwarding_depth_ = saved_forwarding_depth;
   H->set_handles(saved_handles);
 }
 
@@ -1426,7 +1714,8 @@ void Interpreter::Interpret() {
         intptr_t raw_index = index->value() - 1;
         if (array->IsArray()) {
           if ((raw_index >= 0) &&
-              (raw_index < static_cast<Array>(array)->Size())) {
+              (raw_index < static_cast<Array>(array)->Size()) &&
+              !static_cast<Array>(array)->is_shared()) {
             Object value = Stack(0);
             static_cast<Array>(array)->set_element(raw_index, value);
             PopNAndPush(3, value);
@@ -35,6 +35,7 @@ class Interpreter {
                Object receiver,
                String selector,
                Array arguments);
+  bool PerformStacked(intptr_t num_args);
   Method MethodAt(Behavior cls, String selector);
   void ActivateClosure(intptr_t num_args);
 
@@ -140,7 +141,9 @@ class Interpreter {
                               intptr_t depth);
   INLINE void SelfSend(intptr_t selector_index, intptr_t num_args);
   NOINLINE void SelfSendMiss(String selector, intptr_t num_args);
+  Object ResolveFrameReceiver();
 
+  Method PerformTarget(Object receiver, String selector);
   Behavior FindApplicationOf(AbstractMixin mixin, Behavior klass);
   bool HasMethod(Behavior, String selector);
   INLINE String SelectorAt(intptr_t index);
@@ -159,7 +162,16 @@ class Interpreter {
                intptr_t num_args,
                Object receiver,
                Behavior lookup_class,
-               bool present_receiver);
+               bool present_receiver,
+               intptr_t rule);
+  intptr_t ClassifyDNU(Method method, Object receiver, Object* operand);
+  void ActivateDNU(Method method,
+                   intptr_t kind,
+                   Object operand,
+                   String selector,
+                   intptr_t num_args,
+                   Object receiver,
+                   bool present_receiver);
 
   NOINLINE void SendCannotReturn(Object result);
   NOINLINE void SendAboutToReturnThrough(Object result, Activation unwind);
@@ -170,6 +182,9 @@ class Interpreter {
   INLINE void ActivateAbsent(Method method, Object receiver,
                              intptr_t num_args);
   NOINLINE void Activate(Method method, intptr_t num_args);
+  intptr_t ClassifyTarget(Method method, Object* operand);
+  INLINE void ActivateFrameless(intptr_t kind, Object operand,
+                                Object receiver, intptr_t drop);
   NOINLINE void StackOverflow();
 
   INLINE void LocalReturn(Object result);
@@ -199,6 +214,7 @@ class Interpreter {
   Heap* const heap_;
   Isolate* const isolate_;
   jmp_buf* environment_;
+  intptr_t forwarding_depth_;
   LookupCache lookup_cache_;
 };
 
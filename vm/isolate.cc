@@ -23,10 +23,15 @@ thread_local Isolate* Isolate::current_ = NULL;
 Monitor* Isolate::isolates_list_monitor_ = NULL;
 Isolate* Isolate::isolates_list_head_ = NULL;
 ThreadPool* Isolate::thread_pool_ = NULL;
+Mutex* Isolate::snapshots_mutex_ = NULL;
+Isolate::RegisteredSnapshot* Isolate::snapshots_ = NULL;
+intptr_t Isolate::snapshots_size_ = 0;
+intptr_t Isolate::snapshots_capacity_ = 0;
 
 
 void Isolate::Startup() {
   isolates_list_monitor_ = new Monitor();
+  snapshots_mutex_ = new Mutex();
   thread_pool_ = new ThreadPool();
 }
 
@@ -37,6 +42,38 @@ void Isolate::Shutdown() {
   ASSERT(isolates_list_head_ == NULL);
   delete isolates_list_monitor_;
   isolates_list_monitor_ = NULL;
+  for (intptr_t i = 0; i < snapshots_size_; i++) {
+    free(snapshots_[i].snapshot);
+  }
+  free(snapshots_);
+  snapshots_ = NULL;
+  snapshots_size_ = 0;
+  snapshots_capacity_ = 0;
+  delete snapshots_mutex_;
+  snapshots_mutex_ = NULL;
+}
+
+
+intptr_t Isolate::RegisterSnapshot(const void* snapshot, size_t length) {
+  void* copy = malloc(length);
+  if (copy == NULL) {
+    FATAL("Failed to allocate %" Pd " bytes\n", length);
+  }
+  memcpy(copy, snapshot, length);
+
+  MutexLocker ml(snapshots_mutex_);
+  if (snapshots_size_ == snapshots_capacity_) {
+    snapshots_capacity_ =
+        snapshots_capacity_ == 0 ? 4 : snapshots_capacity_ * 2;
+    snapshots_ = reinterpret_cast<RegisteredSnapshot*>(
+        realloc(snapshots_, snapshots_capacity_ * sizeof(RegisteredSnapshot)));
+    if (snapshots_ == NULL) {
+      FATAL("Failed to allocate snapshot registry\n");
+    }
+  }
+  snapshots_[snapshots_size_].snapshot = copy;
+  snapshots_[snapshots_size_].length = length;
+  return ++snapshots_size_;
 }
 
 
@@ -96,7 +133,8 @@ void Isolate::PrintStack() {
 }
 
 
-Isolate::Isolate(void* snapshot, size_t snapshot_length, uint64_t seed) :
+Isolate::Isolate(void* snapshot, size_t snapshot_length, uint64_t seed,
+                 const HeapLimits* limits) :
     heap_(NULL),
     interpreter_(NULL),
     loop_(NULL),
@@ -105,12 +143,15 @@ Isolate::Isolate(void* snapshot, size_t snapshot_length, uint64_t seed) :
     salt_(static_cast<uintptr_t>(seed)),
     random_(seed),
     next_(NULL) {
-  heap_ = new Heap();
+  heap_ = limits == NULL ? new Heap() : new Heap(*limits);
   interpreter_ = new Interpreter(heap_, this);
   loop_ = new PlatformMessageLoop(this);
   {
     Deserializer deserializer(heap_, snapshot, snapshot_length);
     deserializer.Deserialize();
+    if (deserializer.has_salt()) {
+      salt_ = deserializer.salt();
+    }
   }
 
   AddIsolateToList(this);
@@ -133,7 +174,10 @@ Isolate::~Isolate() {
 
 void Isolate::ActivateMessage(IsolateMessage* isolate_message) {
   Object message;
-  if (isolate_message->data() != NULL) {
+  if (isolate_message->shared() != nullptr) {
+    heap_->HoldSharedGraph(isolate_message->TakeGraph());
+    message = isolate_message->shared();
+  } else if (isolate_message->data() != NULL) {
     intptr_t length = isolate_message->length();
     ByteArray bytes = heap_->AllocateByteArray(length);  // SAFEPOINT
     memcpy(bytes->element_addr(0), isolate_message->data(), length);
@@ -221,15 +265,18 @@ class SpawnIsolateTask : public ThreadPool::Task {
  public:
   SpawnIsolateTask(void* snapshot,
                    size_t snapshot_length,
+                   const HeapLimits& limits,
                    IsolateMessage* initial_message) :
     snapshot_(snapshot),
     snapshot_length_(snapshot_length),
+    limits_(limits),
     initial_message_(initial_message) {
   }
 
   virtual void Run() {
     uint64_t seed = OS::CurrentMonotonicNanos();
-    Isolate* child_isolate = new Isolate(snapshot_, snapshot_length_, seed);
+    Isolate* child_isolate =
+        new Isolate(snapshot_, snapshot_length_, seed, &limits_);
     child_isolate->loop()->PostMessage(initial_message_);
     initial_message_ = NULL;
     intptr_t exit_code = child_isolate->loop()->Run();
@@ -242,6 +289,7 @@ class SpawnIsolateTask : public ThreadPool::Task {
  private:
   void* snapshot_;
   size_t snapshot_length_;
+  HeapLimits limits_;
   IsolateMessage* initial_message_;
 
   DISALLOW_COPY_AND_ASSIGN(SpawnIsolateTask);
@@ -250,7 +298,26 @@ class SpawnIsolateTask : public ThreadPool::Task {
 
 void Isolate::Spawn(IsolateMessage* initial_message) {
   thread_pool_->Run(new SpawnIsolateTask(snapshot_, snapshot_length_,
-                                         initial_message));
+                                         HeapLimits(), initial_message));
+}
+
+
+bool Isolate::Spawn(IsolateMessage* initial_message,
+                    intptr_t snapshot_id,
+                    const HeapLimits& limits) {
+  void* snapshot = snapshot_;
+  size_t snapshot_length = snapshot_length_;
+  if (snapshot_id != 0) {
+    MutexLocker ml(snapshots_mutex_);
+    if ((snapshot_id < 1) || (snapshot_id > snapshots_size_)) {
+      return false;
+    }
+    snapshot = snapshots_[snapshot_id - 1].snapshot;
+    snapshot_length = snapshots_[snapshot_id - 1].length;
+  }
+  thread_pool_->Run(new SpawnIsolateTask(snapshot, snapshot_length,
+                                         limits, initial_message));
+  return true;
 }
 
 }  // namespace psoup
@@ -13,15 +13,19 @@
 namespace psoup {
 
 class Heap;
+class HeapObject;
+struct HeapLimits;
 class Interpreter;
 class MessageLoop;
 class Monitor;
+class Mutex;
 class Object;
 class ThreadPool;
 
 class Isolate {
  public:
-  Isolate(void* snapshot, size_t snapshot_length, uint64_t seed);
+  Isolate(void* snapshot, size_t snapshot_length, uint64_t seed,
+          const HeapLimits* limits = NULL);
   ~Isolate();
 
   Heap* heap() const { return heap_; }
@@ -39,6 +43,15 @@ class Isolate {
   void Interpret();
 
   void Spawn(IsolateMessage* initial_message);
+  // Spawns from a registered snapshot, or this isolate's own if snapshot_id is
+  // 0. Answers false if no snapshot is registered under snapshot_id.
+  bool Spawn(IsolateMessage* initial_message,
+             intptr_t snapshot_id,
+             const HeapLimits& limits);
+
+  // Copies a snapshot for spawning isolates from and answers its id. The copy
+  // is kept until shutdown, since isolates spawned from it may spawn more.
+  static intptr_t RegisterSnapshot(const void* snapshot, size_t length);
 
   static Isolate* Current() { return current_; }
   static void Startup();
@@ -72,6 +85,15 @@ class Isolate {
   static Isolate* isolates_list_head_;
   static ThreadPool* thread_pool_;
 
+  struct RegisteredSnapshot {
+    void* snapshot;
+    size_t length;
+  };
+  static Mutex* snapshots_mutex_;
+  static RegisteredSnapshot* snapshots_;
+  static intptr_t snapshots_size_;
+  static intptr_t snapshots_capacity_;
+
   DISALLOW_COPY_AND_ASSIGN(Isolate);
 };
 
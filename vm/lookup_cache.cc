@@ -8,7 +8,9 @@ namespace psoup {
 
 void LookupCache::InsertOrdinary(intptr_t cid,
                                  String selector,
-                                 Method target) {
+                                 Method target,
+                                 intptr_t kind,
+                                 Object operand) {
   intptr_t hash = cid
       ^ (static_cast<intptr_t>(selector) >> kObjectAlignmentLog2);
 
@@ -16,11 +18,15 @@ void LookupCache::InsertOrdinary(intptr_t cid,
   entries_[probe1].ordinary_cid = cid;
   entries_[probe1].ordinary_selector = selector;
   entries_[probe1].ordinary_target = target;
+  entries_[probe1].ordinary_kind = kind;
+  entries_[probe1].ordinary_operand = operand;
 
   intptr_t probe2 = (hash >> 3) & kMask;
   entries_[probe2].ordinary_cid = cid;
   entries_[probe2].ordinary_selector = selector;
   entries_[probe2].ordinary_target = target;
+  entries_[probe2].ordinary_kind = kind;
+  entries_[probe2].ordinary_operand = operand;
 }
 
 
@@ -29,7 +35,9 @@ void LookupCache::InsertNS(intptr_t cid,
                            Method caller,
                            intptr_t rule,
                            Object absent_receiver,
-                           Method target) {
+                           Method target,
+                           intptr_t kind,
+                           Object operand) {
   intptr_t hash = cid
       ^ (static_cast<intptr_t>(selector) >> kObjectAlignmentLog2)
       ^ (static_cast<intptr_t>(caller) >> kObjectAlignmentLog2);
@@ -41,6 +49,8 @@ void LookupCache::InsertNS(intptr_t cid,
   entries_[probe1].ns_caller = caller;
   entries_[probe1].ns_target = target;
   entries_[probe1].ns_absent_receiver = absent_receiver;
+  entries_[probe1].ns_kind = kind;
+  entries_[probe1].ns_operand = operand;
 
   intptr_t probe2 = (hash >> 3) & kMask;
   entries_[probe2].ns_cid_and_rule = cid_and_rule;
@@ -48,6 +58,26 @@ void LookupCache::InsertNS(intptr_t cid,
   entries_[probe2].ns_caller = caller;
   entries_[probe2].ns_target = target;
   entries_[probe2].ns_absent_receiver = absent_receiver;
+  entries_[probe2].ns_kind = kind;
+  entries_[probe2].ns_operand = operand;
+}
+
+
+void LookupCache::InsertPerform(intptr_t cid,
+                                String selector,
+                                Method target) {
+  intptr_t hash = cid
+      ^ (static_cast<intptr_t>(selector) >> kObjectAlignmentLog2);
+
+  intptr_t probe1 = hash & kMask;
+  entries_[probe1].perform_cid = cid;
+  entries_[probe1].perform_selector = selector;
+  entries_[probe1].perform_target = target;
+
+  intptr_t probe2 = (hash >> 3) & kMask;
+  entries_[probe2].perform_cid = cid;
+  entries_[probe2].perform_selector = selector;
+  entries_[probe2].perform_target = target;
 }
 
 
@@ -55,6 +85,7 @@ void LookupCache::Clear() {
   for (intptr_t i = 0; i < kSize; i++) {
     entries_[i].ordinary_cid = kIllegalCid;
     entries_[i].ns_cid_and_rule = kIllegalCid << 16;
+    entries_[i].perform_cid = kIllegalCid;
   }
 }
 
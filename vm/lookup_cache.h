@@ -17,6 +17,18 @@ enum LookupRule {
   kMNU = 258,
 };
 
+// How a cached target can be run. Trivial methods are classified when they are
+// inserted so that a hit can answer without building a frame.
+enum TargetKind {
+  kActivateTarget = 0,
+  kGetterTarget,          // Operand is the slot offset.
+  kSetterTarget,          // Operand is the slot offset.
+  kReturnSelfTarget,
+  kReturnConstantTarget,  // Operand is the constant.
+  kDNUTarget,             // Target is the #doesNotUnderstand: handler.
+  kForwardTarget,         // Likewise, operand is the Forwarder's target slot.
+};
+
 class LookupCache {
  public:
   LookupCache() {
@@ -26,7 +38,9 @@ class LookupCache {
   INLINE
   bool LookupOrdinary(intptr_t cid,
                       String selector,
-                      Method* target) {
+                      Method* target,
+                      intptr_t* kind,
+                      Object* operand) {
     intptr_t hash = cid
         ^ (static_cast<intptr_t>(selector) >> kObjectAlignmentLog2);
 
@@ -34,6 +48,8 @@ class LookupCache {
     if (entries_[probe1].ordinary_cid == cid &&
         entries_[probe1].ordinary_selector == selector) {
       *target = entries_[probe1].ordinary_target;
+      *kind = entries_[probe1].ordinary_kind;
+      *operand = entries_[probe1].ordinary_operand;
       return true;
     }
 
@@ -41,6 +57,8 @@ class LookupCache {
     if (entries_[probe2].ordinary_cid == cid &&
         entries_[probe2].ordinary_selector == selector) {
       *target = entries_[probe2].ordinary_target;
+      *kind = entries_[probe2].ordinary_kind;
+      *operand = entries_[probe2].ordinary_operand;
       return true;
     }
 
@@ -49,7 +67,9 @@ class LookupCache {
 
   void InsertOrdinary(intptr_t cid,
                       String selector,
-                      Method target);
+                      Method target,
+                      intptr_t kind,
+                      Object operand);
 
   INLINE
   bool LookupNS(intptr_t cid,
@@ -57,7 +77,9 @@ class LookupCache {
                 Method caller,
                 intptr_t rule,
                 Object* absent_receiver,
-                Method* target) {
+                Method* target,
+                intptr_t* kind,
+                Object* operand) {
     intptr_t hash = cid
         ^ (static_cast<intptr_t>(selector) >> kObjectAlignmentLog2)
         ^ (static_cast<intptr_t>(caller) >> kObjectAlignmentLog2);
@@ -69,6 +91,8 @@ class LookupCache {
         entries_[probe1].ns_caller == caller) {
       *absent_receiver = entries_[probe1].ns_absent_receiver;
       *target = entries_[probe1].ns_target;
+      *kind = entries_[probe1].ns_kind;
+      *operand = entries_[probe1].ns_operand;
       return true;
     }
 
@@ -78,6 +102,8 @@ class LookupCache {
         entries_[probe2].ns_caller == caller) {
       *absent_receiver = entries_[probe2].ns_absent_receiver;
       *target = entries_[probe2].ns_target;
+      *kind = entries_[probe2].ns_kind;
+      *operand = entries_[probe2].ns_operand;
       return true;
     }
 
@@ -89,7 +115,40 @@ class LookupCache {
                 Method caller,
                 intptr_t rule,
                 Object absent_receiver,
-                Method target);
+                Method target,
+                intptr_t kind,
+                Object operand);
+
+  // Reflective sends have a table of their own so that perform: with dynamic
+  // selectors does not evict the entries of ordinary send sites. A nil target
+  // records that the receiver does not publicly understand the selector.
+  INLINE
+  bool LookupPerform(intptr_t cid,
+                     String selector,
+                     Method* target) {
+    intptr_t hash = cid
+        ^ (static_cast<intptr_t>(selector) >> kObjectAlignmentLog2);
+
+    intptr_t probe1 = hash & kMask;
+    if (entries_[probe1].perform_cid == cid &&
+        entries_[probe1].perform_selector == selector) {
+      *target = entries_[probe1].perform_target;
+      return true;
+    }
+
+    intptr_t probe2 = (hash >> 3) & kMask;
+    if (entries_[probe2].perform_cid == cid &&
+        entries_[probe2].perform_selector == selector) {
+      *target = entries_[probe2].perform_target;
+      return true;
+    }
+
+    return false;
+  }
+
+  void InsertPerform(intptr_t cid,
+                     String selector,
+                     Method target);
 
   void Clear();
 
@@ -98,12 +157,20 @@ class LookupCache {
     intptr_t ordinary_cid;
     String ordinary_selector;
     Method ordinary_target;
+    intptr_t ordinary_kind;
+    Object ordinary_operand;
 
     intptr_t ns_cid_and_rule;
     String ns_selector;
     Method ns_caller;
     Object ns_absent_receiver;
     Method ns_target;
+    intptr_t ns_kind;
+    Object ns_operand;
+
+    intptr_t perform_cid;
+    String perform_selector;
+    Method perform_target;
   };
 
   static constexpr intptr_t kSize = 512;
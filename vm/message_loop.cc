@@ -10,11 +10,88 @@
 
 namespace psoup {
 
+MessageQueue::MessageQueue() : length_(0) {
+  for (intptr_t i = 0; i < kNumMessagePriorities; i++) {
+    head_[i] = tail_[i] = NULL;
+    depth_[i] = 0;
+    passed_over_[i] = 0;
+  }
+}
+
+MessageQueue::~MessageQueue() {
+  IsolateMessage* message;
+  while ((message = Dequeue()) != NULL) {
+    delete message;
+  }
+}
+
+void MessageQueue::Enqueue(IsolateMessage* message) {
+  intptr_t lane = message->lane();
+  ASSERT((lane >= 0) && (lane < kNumMessagePriorities));
+  message->next_ = NULL;
+  if (head_[lane] == NULL) {
+    head_[lane] = tail_[lane] = message;
+    passed_over_[lane] = 0;
+  } else {
+    tail_[lane]->next_ = message;
+    tail_[lane] = message;
+  }
+  depth_[lane]++;
+  length_++;
+}
+
+IsolateMessage* MessageQueue::Dequeue() {
+  if (length_ == 0) {
+    return NULL;
+  }
+  intptr_t lane = -1;
+  for (intptr_t i = 0; i < kNumMessagePriorities - 1; i++) {
+    if ((head_[i] != NULL) && (passed_over_[i] >= kMaxPassedOver)) {
+      lane = i;
+      break;
+    }
+  }
+  if (lane == -1) {
+    lane = kNumMessagePriorities - 1;
+    while (head_[lane] == NULL) {
+      lane--;
+    }
+  }
+  for (intptr_t i = 0; i < lane; i++) {
+    if (head_[i] != NULL) {
+      passed_over_[i]++;
+    }
+  }
+  passed_over_[lane] = 0;
+
+  IsolateMessage* message = head_[lane];
+  head_[lane] = message->next_;
+  if (head_[lane] == NULL) {
+    tail_[lane] = NULL;
+  }
+  message->next_ = NULL;
+  depth_[lane]--;
+  length_--;
+  return message;
+}
+
 MessageLoop::MessageLoop(Isolate* isolate)
     : isolate_(isolate), open_ports_(0), open_waits_(0), exit_code_(0) {}
 
 MessageLoop::~MessageLoop() {}
 
+intptr_t MessageLoop::CountMessages(IsolateMessage* head, intptr_t priority) {
+  intptr_t count = 0;
+  for (IsolateMessage* message = head;
+       message != NULL;
+       message = message->next_) {
+    if (message->lane() == priority) {
+      count++;
+    }
+  }
+  return count;
+}
+
 void MessageLoop::DispatchMessage(IsolateMessage* message) {
   if (isolate_ == NULL) {
     delete message;
@@ -5,34 +5,131 @@
 #ifndef VM_MESSAGE_LOOP_H_
 #define VM_MESSAGE_LOOP_H_
 
+#include <string.h>
+
+#include <atomic>
+#include <new>
+
+#include "vm/message_pool.h"
 #include "vm/port.h"
+#include "vm/shared_graph.h"
 
 namespace psoup {
 
 class Isolate;
 
+// Lanes of an isolate's message queue. Control traffic sent at a higher
+// priority overtakes bulk data waiting in lower lanes. Only the epoll loop
+// keeps lanes; the other loops still deliver in arrival order.
+enum MessagePriority {
+  kPortPriority = -1,  // Whatever the destination port was given.
+  kLowPriority = 0,
+  kNormalPriority = 1,
+  kHighPriority = 2,
+  kNumMessagePriorities = 3,
+};
+
+// The serialized bytes of a multicast, copied once and shared by the message
+// to each destination. Each message holds one reference; the payload is freed
+// with the last message, after every receiver has copied it into its heap.
+class MessagePayload {
+ public:
+  static MessagePayload* New(const uint8_t* data,
+                             intptr_t length,
+                             intptr_t refcount) {
+    void* memory = MessagePool::Allocate(sizeof(MessagePayload) + length);
+    MessagePayload* payload = new (memory) MessagePayload(length, refcount);
+    memcpy(payload->data(), data, length);
+    return payload;
+  }
+
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+  intptr_t length() const { return length_; }
+
+  void Release() {
+    if (refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      this->~MessagePayload();
+      MessagePool::Free(this);
+    }
+  }
+
+ private:
+  MessagePayload(intptr_t length, intptr_t refcount)
+      : length_(length), refcount_(refcount) {}
+
+  intptr_t length_;
+  std::atomic<intptr_t> refcount_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePayload);
+};
+
 class IsolateMessage {
  public:
   IsolateMessage(Port dest, uint8_t* data, intptr_t length)
       : next_(NULL), dest_(dest),
         data_(data), length_(length),
-        argv_(NULL), argc_(0) {}
+        argv_(NULL), argc_(0), graph_(NULL), shared_(nullptr),
+        payload_(NULL), priority_(kPortPriority) {}
+  IsolateMessage(Port dest, MessagePayload* payload)
+      : next_(NULL), dest_(dest),
+        data_(payload->data()), length_(payload->length()),
+        argv_(NULL), argc_(0), graph_(NULL), shared_(nullptr),
+        payload_(payload), priority_(kPortPriority) {}
   IsolateMessage(Port dest, int argc, const char** argv)
       : next_(NULL), dest_(dest),
         data_(NULL), length_(0),
-        argv_(argv), argc_(argc) {}
-
-  ~IsolateMessage() { free(data_); }
+        argv_(argv), argc_(argc), graph_(NULL), shared_(nullptr),
+        payload_(NULL), priority_(kPortPriority) {}
+  IsolateMessage(Port dest, SharedGraph* graph, HeapObject shared)
+      : next_(NULL), dest_(dest),
+        data_(NULL), length_(0),
+        argv_(NULL), argc_(0), graph_(graph), shared_(shared),
+        payload_(NULL), priority_(kPortPriority) {}
+
+  ~IsolateMessage() {
+    if (payload_ != NULL) {
+      payload_->Release();
+    } else {
+      MessagePool::Free(data_);
+    }
+    if (graph_ != NULL) {
+      graph_->Release();
+    }
+  }
+
+  static void* operator new(size_t size) {
+    return MessagePool::Allocate(size);
+  }
+  static void operator delete(void* ptr) { MessagePool::Free(ptr); }
 
   Port dest_port() const { return dest_; }
   uint8_t* data() const { return data_; }
   intptr_t length() const { return length_; }
   int argc() const { return argc_; }
   const char** argv() const { return argv_; }
+  HeapObject shared() const { return shared_; }
+  intptr_t priority() const { return priority_; }
+  void set_priority(intptr_t priority) { priority_ = priority; }
+
+  // The queue lane this message waits in.
+  intptr_t lane() const {
+    // Not sent through a port, such as an isolate's initial message.
+    if (priority_ == kPortPriority) {
+      return kNormalPriority;
+    }
+    return priority_;
+  }
+
+  // Transfers the message's reference to the receiving isolate.
+  SharedGraph* TakeGraph() {
+    SharedGraph* graph = graph_;
+    graph_ = NULL;
+    return graph;
+  }
 
  private:
   friend class MessageLoop;
-  friend class EPollMessageLoop;
+  friend class MessageQueue;
   friend class EmscriptenMessageLoop;
   friend class FuchsiaMessageLoop;
   friend class IOCPMessageLoop;
@@ -40,14 +137,46 @@ class IsolateMessage {
 
   IsolateMessage* next_;
   Port dest_;
-  uint8_t* data_;  // Owned by message.
+  uint8_t* data_;  // Owned by message unless within payload_. From MessagePool.
   intptr_t length_;
   const char** argv_;  // Not owned by message.
   int argc_;
+  SharedGraph* graph_;  // Reference owned by message until delivered.
+  HeapObject shared_;  // Within graph_.
+  MessagePayload* payload_;  // Reference owned by message.
+  intptr_t priority_;
 
   DISALLOW_COPY_AND_ASSIGN(IsolateMessage);
 };
 
+// The messages waiting for an isolate, in one FIFO lane per priority. Higher
+// lanes are taken first, but a nonempty lane is passed over at most
+// kMaxPassedOver times in a row, so bulk data still drains under a steady
+// stream of control messages. Callers synchronize access.
+class MessageQueue {
+ public:
+  MessageQueue();
+  ~MessageQueue();  // Deletes any messages left.
+
+  void Enqueue(IsolateMessage* message);
+  IsolateMessage* Dequeue();  // NULL if empty.
+
+  bool IsEmpty() const { return length_ == 0; }
+  intptr_t length() const { return length_; }
+  intptr_t Depth(intptr_t priority) const { return depth_[priority]; }
+
+ private:
+  static const intptr_t kMaxPassedOver = 8;
+
+  IsolateMessage* head_[kNumMessagePriorities];
+  IsolateMessage* tail_[kNumMessagePriorities];
+  intptr_t depth_[kNumMessagePriorities];
+  intptr_t passed_over_[kNumMessagePriorities];
+  intptr_t length_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessageQueue);
+};
+
 enum {
   kReadEvent = 0x1,
   kWriteEvent = 0x2,
@@ -69,10 +198,16 @@ class MessageLoop {
   virtual intptr_t Run() = 0;
   virtual void Interrupt() = 0;
 
+  // Number of messages waiting in the given lane.
+  virtual intptr_t QueueDepth(intptr_t priority) = 0;
+
   Port OpenPort();
   void ClosePort(Port p);
 
  protected:
+  // For loops that keep a single FIFO, which ignores priorities.
+  static intptr_t CountMessages(IsolateMessage* head, intptr_t priority);
+
   void DispatchMessage(IsolateMessage* message);
   void DispatchWakeup();
   void DispatchSignal(intptr_t handle,
@@ -59,6 +59,10 @@ void EmscriptenMessageLoop::PostMessage(IsolateMessage* message) {
   }
 }
 
+intptr_t EmscriptenMessageLoop::QueueDepth(intptr_t priority) {
+  return CountMessages(head_, priority);
+}
+
 intptr_t EmscriptenMessageLoop::Run() {
   UNREACHABLE();
   return -1;
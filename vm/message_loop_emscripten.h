@@ -30,6 +30,8 @@ class EmscriptenMessageLoop : public MessageLoop {
   intptr_t Run();
   void Interrupt();
 
+  intptr_t QueueDepth(intptr_t priority);
+
   int HandleMessage();
   int HandleSignal(int handle, int status, int signals, int count);
 
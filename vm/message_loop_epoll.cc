@@ -37,8 +37,9 @@ static bool SetBlockingHelper(intptr_t fd, bool blocking) {
 EPollMessageLoop::EPollMessageLoop(Isolate* isolate)
     : MessageLoop(isolate),
       mutex_(),
-      head_(NULL),
-      tail_(NULL),
+      queue_(),
+      pending_(false),
+      sleeping_(false),
       wakeup_(0) {
   int result = pipe(interrupt_fds_);
   if (result != 0) {
@@ -129,12 +130,14 @@ void EPollMessageLoop::Exit(intptr_t exit_code) {
 
 void EPollMessageLoop::PostMessage(IsolateMessage* message) {
   MutexLocker locker(&mutex_);
-  if (head_ == NULL) {
-    head_ = tail_ = message;
-    Notify();
-  } else {
-    tail_->next_ = message;
-    tail_ = message;
+  bool was_empty = queue_.IsEmpty();
+  queue_.Enqueue(message);
+  if (was_empty) {
+    // Pairs with AwaitMessages: either it sees the message or we see it asleep.
+    pending_.store(true, std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_seq_cst)) {
+      Notify();
+    }
   }
 }
 
@@ -146,20 +149,61 @@ void EPollMessageLoop::Notify() {
   }
 }
 
-IsolateMessage* EPollMessageLoop::TakeMessages() {
+intptr_t EPollMessageLoop::QueueDepth(intptr_t priority) {
+  MutexLocker locker(&mutex_);
+  return queue_.Depth(priority);
+}
+
+intptr_t EPollMessageLoop::PendingMessages() {
   MutexLocker locker(&mutex_);
-  IsolateMessage* message = head_;
-  head_ = tail_ = NULL;
+  return queue_.length();
+}
+
+IsolateMessage* EPollMessageLoop::TakeMessage() {
+  MutexLocker locker(&mutex_);
+  IsolateMessage* message = queue_.Dequeue();
+  if (queue_.IsEmpty()) {
+    pending_.store(false, std::memory_order_relaxed);
+  }
   return message;
 }
 
+// Replies from other isolates often arrive within a few microseconds, sooner
+// than a sleep in epoll_wait and the wakeup through the interrupt pipe. So
+// spin for a while before blocking. Answers whether there are messages, in
+// which case Run only polls for other events. Otherwise, PostMessage will
+// interrupt the wait.
+bool EPollMessageLoop::AwaitMessages() {
+  if (pending_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  intptr_t limit = spin_.limit();
+  for (intptr_t i = 0; i < limit; i++) {
+    SpinBudget::Relax();
+    if (pending_.load(std::memory_order_relaxed)) {
+      spin_.Succeeded();
+      return true;
+    }
+  }
+  spin_.Failed();
+
+  sleeping_.store(true, std::memory_order_seq_cst);
+  if (pending_.load(std::memory_order_seq_cst)) {
+    sleeping_.store(false, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
 intptr_t EPollMessageLoop::Run() {
   while (isolate_ != NULL) {
     static const intptr_t kMaxEvents = 16;
     struct epoll_event events[kMaxEvents];
 
-    int result = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
-    if (result <= 0) {
+    int timeout = AwaitMessages() ? 0 : -1;
+    int result = epoll_wait(epoll_fd_, events, kMaxEvents, timeout);
+    sleeping_.store(false, std::memory_order_relaxed);
+    if (result < 0) {
       if ((errno != EWOULDBLOCK) && (errno != EINTR)) {
         FATAL("epoll_wait failed");
       }
@@ -200,11 +244,14 @@ intptr_t EPollMessageLoop::Run() {
       }
     }
 
-    IsolateMessage* message = TakeMessages();
-    while (message != NULL) {
-      IsolateMessage* next = message->next_;
+    // Messages posted while dispatching wait until other events have been
+    // polled again, though they may overtake lower lanes of this round.
+    for (intptr_t n = PendingMessages(); n > 0; n--) {
+      IsolateMessage* message = TakeMessage();
+      if (message == NULL) {
+        break;
+      }
       DispatchMessage(message);
-      message = next;
     }
   }
 
@@ -212,9 +259,8 @@ intptr_t EPollMessageLoop::Run() {
     PortMap::CloseAllPorts(this);
   }
 
-  while (head_ != NULL) {
-    IsolateMessage* message = head_;
-    head_ = message->next_;
+  IsolateMessage* message;
+  while ((message = TakeMessage()) != NULL) {
     delete message;
   }
 
@@ -10,7 +10,10 @@
   instead.
 #endif
 
+#include <atomic>
+
 #include "vm/message_loop.h"
+#include "vm/spin_budget.h"
 #include "vm/thread.h"
 
 namespace psoup {
@@ -31,13 +34,19 @@ class EPollMessageLoop : public MessageLoop {
   intptr_t Run();
   void Interrupt();
 
+  intptr_t QueueDepth(intptr_t priority);
+
  private:
-  IsolateMessage* TakeMessages();
+  intptr_t PendingMessages();
+  IsolateMessage* TakeMessage();
+  bool AwaitMessages();
   void Notify();
 
   Mutex mutex_;
-  IsolateMessage* head_;
-  IsolateMessage* tail_;
+  MessageQueue queue_;
+  std::atomic<bool> pending_;  // Whether queue_ is nonempty.
+  std::atomic<bool> sleeping_;  // Whether PostMessage must interrupt.
+  SpinBudget spin_;
   int64_t wakeup_;
   int interrupt_fds_[2];
   int timer_fd_;
@@ -11,16 +11,22 @@
 #include <zircon/status.h>
 #include <zircon/syscalls.h>
 
+#include "vm/lockers.h"
 #include "vm/os.h"
 
 namespace psoup {
 
 FuchsiaMessageLoop::FuchsiaMessageLoop(Isolate* isolate)
     : MessageLoop(isolate),
+      mutex_(),
       loop_(),
       timer_(ZX_HANDLE_INVALID),
       timer_wait_(this),
       wakeup_(0) {
+  for (intptr_t i = 0; i < kNumMessagePriorities; i++) {
+    depth_[i] = 0;
+  }
+
   zx_status_t status =
       async_loop_create(&kAsyncLoopConfigNeverAttachToThread, &loop_);
   ASSERT(status == ZX_OK);
@@ -95,8 +101,24 @@ void FuchsiaMessageLoop::Exit(intptr_t exit_code) {
 }
 
 void FuchsiaMessageLoop::PostMessage(IsolateMessage* message) {
+  intptr_t lane = message->lane();
+  {
+    MutexLocker locker(&mutex_);
+    depth_[lane]++;
+  }
   async::PostTask(async_loop_get_dispatcher(loop_),
-                  [this, message] { DispatchMessage(message); });
+                  [this, message, lane] {
+                    {
+                      MutexLocker locker(&mutex_);
+                      depth_[lane]--;
+                    }
+                    DispatchMessage(message);
+                  });
+}
+
+intptr_t FuchsiaMessageLoop::QueueDepth(intptr_t priority) {
+  MutexLocker locker(&mutex_);
+  return depth_[priority];
 }
 
 intptr_t FuchsiaMessageLoop::Run() {
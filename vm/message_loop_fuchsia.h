@@ -15,6 +15,7 @@
 #include <lib/zx/timer.h>
 
 #include "vm/port.h"
+#include "vm/thread.h"
 
 namespace psoup {
 
@@ -34,6 +35,8 @@ class FuchsiaMessageLoop : public MessageLoop {
   intptr_t Run();
   void Interrupt();
 
+  intptr_t QueueDepth(intptr_t priority);
+
  private:
   void OnHandleReady(async_dispatcher_t* async,
                      async::WaitBase* wait,
@@ -43,6 +46,8 @@ class FuchsiaMessageLoop : public MessageLoop {
   using Wait =
       async::WaitMethod<FuchsiaMessageLoop, &FuchsiaMessageLoop::OnHandleReady>;
 
+  Mutex mutex_;
+  intptr_t depth_[kNumMessagePriorities];  // Messages with a pending task.
   async_loop_t* loop_;
   zx::timer timer_;
   Wait timer_wait_;
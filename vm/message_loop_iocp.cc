@@ -74,6 +74,11 @@ void IOCPMessageLoop::Notify() {
   }
 }
 
+intptr_t IOCPMessageLoop::QueueDepth(intptr_t priority) {
+  MutexLocker locker(&mutex_);
+  return CountMessages(head_, priority);
+}
+
 IsolateMessage* IOCPMessageLoop::TakeMessages() {
   MutexLocker locker(&mutex_);
   IsolateMessage* message = head_;
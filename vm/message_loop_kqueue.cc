@@ -131,6 +131,11 @@ void KQueueMessageLoop::Notify() {
   }
 }
 
+intptr_t KQueueMessageLoop::QueueDepth(intptr_t priority) {
+  MutexLocker locker(&mutex_);
+  return CountMessages(head_, priority);
+}
+
 IsolateMessage* KQueueMessageLoop::TakeMessages() {
   MutexLocker locker(&mutex_);
   IsolateMessage* message = head_;
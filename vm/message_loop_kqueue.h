@@ -31,6 +31,8 @@ class KQueueMessageLoop : public MessageLoop {
   intptr_t Run();
   void Interrupt();
 
+  intptr_t QueueDepth(intptr_t priority);
+
  private:
   IsolateMessage* TakeMessages();
   void Notify();
@@ -0,0 +1,195 @@
+// Copyright (c) 2016, the Newspeak project authors. Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/message_pool.h"
+
+#include "vm/assert.h"
+
+namespace psoup {
+
+struct MessagePool::Block {
+  MessagePool* owner;  // NULL if unpooled.
+  intptr_t size_class;
+  Block* next;  // Overlaps the payload; only valid while free.
+};
+
+static constexpr intptr_t kBlockHeaderSize = 2 * sizeof(uword);
+
+static void* PayloadOf(void* block) {
+  return reinterpret_cast<uint8_t*>(block) + kBlockHeaderSize;
+}
+
+static void* BlockOf(void* payload) {
+  return reinterpret_cast<uint8_t*>(payload) - kBlockHeaderSize;
+}
+
+class MessagePoolBinding {
+ public:
+  constexpr MessagePoolBinding() : pool_(NULL) {}
+  ~MessagePoolBinding() {
+    if (pool_ != NULL) {
+      pool_->in_use_.store(false, std::memory_order_release);
+      pool_ = NULL;
+    }
+  }
+
+  MessagePool* pool_;
+};
+
+#if defined(OS_EMSCRIPTEN)
+static MessagePoolBinding binding_;
+#else
+static thread_local MessagePoolBinding binding_;
+#endif
+
+std::atomic<MessagePool*> MessagePool::pools_(NULL);
+
+
+MessagePool::MessagePool() : remote_free_(NULL), in_use_(true), next_(NULL) {
+  for (intptr_t i = 0; i < kSizeClasses; i++) {
+    free_[i] = NULL;
+    free_count_[i] = 0;
+  }
+}
+
+
+MessagePool* MessagePool::Current() {
+  MessagePool* pool = binding_.pool_;
+  if (pool == NULL) {
+    pool = Acquire();
+    binding_.pool_ = pool;
+  }
+  return pool;
+}
+
+
+MessagePool* MessagePool::Acquire() {
+  for (MessagePool* pool = pools_.load(std::memory_order_acquire);
+       pool != NULL;
+       pool = pool->next_) {
+    bool expected = false;
+    if (pool->in_use_.compare_exchange_strong(expected, true,
+                                              std::memory_order_acquire)) {
+      return pool;
+    }
+  }
+
+  MessagePool* pool = new MessagePool();
+  pool->next_ = pools_.load(std::memory_order_relaxed);
+  while (!pools_.compare_exchange_weak(pool->next_, pool,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+  }
+  return pool;
+}
+
+
+intptr_t MessagePool::SizeClassFor(intptr_t size) {
+  intptr_t block_size = size + kBlockHeaderSize;
+  if (block_size > (static_cast<intptr_t>(1) << kMaxSizeLog2)) {
+    return kUnpooled;
+  }
+  intptr_t size_class = 0;
+  while ((static_cast<intptr_t>(1) << (size_class + kMinSizeLog2)) <
+         block_size) {
+    size_class++;
+  }
+  return size_class;
+}
+
+
+intptr_t MessagePool::MaxCached(intptr_t size_class) {
+  intptr_t max_cached = kCacheBytes >> (size_class + kMinSizeLog2);
+  return max_cached < kMinCached ? kMinCached : max_cached;
+}
+
+
+void* MessagePool::Allocate(intptr_t size) {
+  ASSERT(size >= 0);
+  intptr_t size_class = SizeClassFor(size);
+  MessagePool* pool = NULL;
+  Block* block = NULL;
+  if (size_class != kUnpooled) {
+    pool = Current();
+    block = pool->TryAllocate(size_class);
+  }
+  if (block == NULL) {
+    intptr_t block_size = size_class == kUnpooled
+        ? size + kBlockHeaderSize
+        : static_cast<intptr_t>(1) << (size_class + kMinSizeLog2);
+    block = reinterpret_cast<Block*>(malloc(block_size));
+    if (block == NULL) {
+      FATAL("Failed to allocate %" Pd " bytes\n", block_size);
+    }
+    block->size_class = size_class;
+  }
+  block->owner = pool;
+  return PayloadOf(block);
+}
+
+
+void MessagePool::Free(void* ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  Block* block = reinterpret_cast<Block*>(BlockOf(ptr));
+  MessagePool* owner = block->owner;
+  if (owner == NULL) {
+    ASSERT(block->size_class == kUnpooled);
+    free(block);
+  } else if (owner == binding_.pool_) {
+    owner->FreeLocal(block);
+  } else {
+    owner->FreeRemote(block);
+  }
+}
+
+
+MessagePool::Block* MessagePool::TryAllocate(intptr_t size_class) {
+  if (free_[size_class] == NULL) {
+    ReclaimRemote();
+  }
+  Block* block = free_[size_class];
+  if (block != NULL) {
+    free_[size_class] = block->next;
+    free_count_[size_class]--;
+  }
+  return block;
+}
+
+
+void MessagePool::FreeLocal(Block* block) {
+  intptr_t size_class = block->size_class;
+  ASSERT((size_class >= 0) && (size_class < kSizeClasses));
+  if (free_count_[size_class] >= MaxCached(size_class)) {
+    free(block);
+    return;
+  }
+  block->next = free_[size_class];
+  free_[size_class] = block;
+  free_count_[size_class]++;
+}
+
+
+void MessagePool::FreeRemote(Block* block) {
+  block->next = remote_free_.load(std::memory_order_relaxed);
+  while (!remote_free_.compare_exchange_weak(block->next, block,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+  }
+}
+
+
+void MessagePool::ReclaimRemote() {
+  // Only the owning thread takes from the remote list, and it takes the whole
+  // list at once, so there is no ABA problem.
+  Block* block = remote_free_.exchange(NULL, std::memory_order_acquire);
+  while (block != NULL) {
+    Block* next = block->next;
+    FreeLocal(block);
+    block = next;
+  }
+}
+
+}  // namespace psoup
@@ -0,0 +1,64 @@
+// Copyright (c) 2016, the Newspeak project authors. Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_MESSAGE_POOL_H_
+#define VM_MESSAGE_POOL_H_
+
+#include <atomic>
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace psoup {
+
+// Per-thread pools of size-classed blocks for IsolateMessages and their
+// payloads. A message is usually allocated by the sending isolate's thread and
+// freed by the receiving isolate's thread, so blocks freed by a thread other
+// than the owner are pushed onto the owner's remote free list, which the owner
+// reclaims in bulk on its next allocation. Pools are never deallocated: when a
+// thread exits its pool is released for adoption by the next new thread.
+class MessagePool {
+ public:
+  static void* Allocate(intptr_t size);
+  static void Free(void* ptr);
+
+ private:
+  struct Block;
+
+  static constexpr intptr_t kMinSizeLog2 = 6;   // 64 B
+  static constexpr intptr_t kMaxSizeLog2 = 16;  // 64 KB
+  static constexpr intptr_t kSizeClasses = kMaxSizeLog2 - kMinSizeLog2 + 1;
+  static constexpr intptr_t kUnpooled = -1;
+  // Bytes cached per size class.
+  static constexpr intptr_t kCacheBytes = 256 * KB;
+  static constexpr intptr_t kMinCached = 4;
+
+  MessagePool();
+
+  static MessagePool* Current();
+  static MessagePool* Acquire();
+  static intptr_t SizeClassFor(intptr_t size);
+  static intptr_t MaxCached(intptr_t size_class);
+
+  Block* TryAllocate(intptr_t size_class);
+  void FreeLocal(Block* block);
+  void FreeRemote(Block* block);
+  void ReclaimRemote();
+
+  Block* free_[kSizeClasses];
+  intptr_t free_count_[kSizeClasses];
+  std::atomic<Block*> remote_free_;
+  std::atomic<bool> in_use_;
+  MessagePool* next_;  // All pools; push only.
+
+  static std::atomic<MessagePool*> pools_;
+
+  friend class MessagePoolBinding;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePool);
+};
+
+}  // namespace psoup
+
+#endif  // VM_MESSAGE_POOL_H_
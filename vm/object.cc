@@ -249,7 +249,8 @@ static uintptr_t kFNVPrime = 1099511628211;
 
 
 SmallInteger String::EnsureHash(Isolate* isolate) {
-  if (header_hash() == 0) {
+  // Shared strings are read-only and seen by isolates with different salts.
+  if ((header_hash() == 0) || is_shared()) {
     // FNV-1a hash
     intptr_t length = Size();
     uintptr_t h = length + 1;
@@ -262,6 +263,9 @@ SmallInteger String::EnsureHash(Isolate* isolate) {
     if (h == 0) {
       h = 1;
     }
+    if (is_shared()) {
+      return SmallInteger::New(h);
+    }
     set_header_hash(h);
   }
   return SmallInteger::New(header_hash());
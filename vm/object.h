@@ -44,6 +44,9 @@ enum HeaderBits {
   // For symbols.
   kCanonicalBit = 2,
 
+  // In a SharedGraph: deeply immutable and outside every isolate's heap.
+  kSharedBit = 3,
+
 #if defined(ARCH_IS_32_BIT)
   kSizeFieldOffset = 8,
   kSizeFieldSize = 8,
@@ -218,6 +221,8 @@ class HeapObject : public Object {
   inline void set_is_remembered(bool value);
   inline bool is_canonical() const;
   inline void set_is_canonical(bool value);
+  inline bool is_shared() const;
+  inline void set_is_shared(bool value);
   inline intptr_t heap_size() const;
   inline void set_heap_size(intptr_t value);
   inline intptr_t cid() const;
@@ -266,12 +271,27 @@ class HeapObject : public Object {
     }
   }
 
+  // Bulk store with a single barrier decision for the whole range. The
+  // ranges may overlap.
+  void StoreRange(Object* dst, const Object* src, intptr_t count) {
+    memmove(dst, src, count * sizeof(Object));
+    if (IsOldObject() && !is_remembered()) {
+      for (intptr_t i = 0; i < count; i++) {
+        if (dst[i]->IsNewObject()) {
+          AddToRememberedSet();
+          return;
+        }
+      }
+    }
+  }
+
  private:
   void AddToRememberedSet() const;
 
   class MarkBit : public BitField<bool, kMarkBit, 1> {};
   class RememberedBit : public BitField<bool, kRememberedBit, 1> {};
   class CanonicalBit : public BitField<bool, kCanonicalBit, 1> {};
+  class SharedBit : public BitField<bool, kSharedBit, 1> {};
   class SizeField :
       public BitField<intptr_t, kSizeFieldOffset, kSizeFieldSize> {};
   class ClassIdField :
@@ -449,6 +469,8 @@ class Array : public HeapObject {
   inline Object element(intptr_t index) const;
   inline void set_element(intptr_t index, Object value,
                           Barrier barrier = kBarrier);
+  inline void CopyElements(intptr_t index, Array source,
+                           intptr_t source_index, intptr_t count);
 
   inline Object* from();
   inline Object* to();
@@ -909,6 +931,12 @@ bool HeapObject::is_canonical() const {
 void HeapObject::set_is_canonical(bool value) {
   ptr()->header_ = CanonicalBit::update(value, ptr()->header_);
 }
+bool HeapObject::is_shared() const {
+  return SharedBit::decode(ptr()->header_);
+}
+void HeapObject::set_is_shared(bool value) {
+  ptr()->header_ = SharedBit::update(value, ptr()->header_);
+}
 intptr_t HeapObject::heap_size() const {
   return SizeField::decode(ptr()->header_) << kObjectAlignmentLog2;
 }
@@ -1033,6 +1061,12 @@ Object Array::element(intptr_t index) const {
 void Array::set_element(intptr_t index, Object value, Barrier barrier) {
   Store(&ptr()->elements_[index], value, barrier);
 }
+void Array::CopyElements(intptr_t index, Array source,
+                         intptr_t source_index, intptr_t count) {
+  StoreRange(&ptr()->elements_[index],
+             &source->ptr()->elements_[source_index],
+             count);
+}
 Object* Array::from() {
   return &ptr()->elements_[0];
 }
@@ -17,7 +17,10 @@ class OS {
   static int64_t CurrentMonotonicNanos();
 
   static const char* Name();
+  // Respects container limits where the platform has them.
   static intptr_t NumberOfAvailableProcessors();
+  // Bytes of memory available to the process, or 0 if unknown.
+  static int64_t MemoryLimit();
 
   static void DebugBreak();
 
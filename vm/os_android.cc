@@ -45,6 +45,12 @@ intptr_t OS::NumberOfAvailableProcessors() {
 }
 
 
+int64_t OS::MemoryLimit() {
+  return static_cast<int64_t>(sysconf(_SC_PHYS_PAGES)) *
+      static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+}
+
+
 void OS::DebugBreak() {
   __builtin_trap();
 }
@@ -34,6 +34,11 @@ intptr_t OS::NumberOfAvailableProcessors() {
 }
 
 
+int64_t OS::MemoryLimit() {
+  return 0;  // Unknown.
+}
+
+
 void OS::DebugBreak() {
   emscripten_debugger();
 }
@@ -33,6 +33,11 @@ intptr_t OS::NumberOfAvailableProcessors() {
 }
 
 
+int64_t OS::MemoryLimit() {
+  return zx_system_get_physmem();
+}
+
+
 void OS::DebugBreak() {
   __builtin_trap();
 }
@@ -8,9 +8,11 @@
 #include "vm/os.h"
 
 #include <errno.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -18,7 +20,173 @@
 
 namespace psoup {
 
-void OS::Startup() {}
+static intptr_t available_processors_ = 0;
+static int64_t memory_limit_ = 0;
+
+static const char kCgroupRoot[] = "/sys/fs/cgroup";
+
+
+static bool ReadFile(const char* path, char* buffer, size_t size) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    return false;
+  }
+  size_t length = fread(buffer, 1, size - 1, f);
+  fclose(f);
+  buffer[length] = 0;
+  return length != 0;
+}
+
+
+// Finds this process's cgroup for a cgroup v1 controller, or for the unified
+// cgroup v2 hierarchy if controller is NULL.
+static bool FindCgroup(const char* controller, char* path, size_t size) {
+  char contents[4096];
+  if (!ReadFile("/proc/self/cgroup", contents, sizeof(contents))) {
+    return false;
+  }
+  // Each line is hierarchy-id:controller-list:path.
+  char* line_state;
+  for (char* line = strtok_r(contents, "\n", &line_state);
+       line != NULL;
+       line = strtok_r(NULL, "\n", &line_state)) {
+    char* controllers = strchr(line, ':');
+    if (controllers == NULL) continue;
+    controllers++;
+    char* cgroup = strchr(controllers, ':');
+    if (cgroup == NULL) continue;
+    *cgroup++ = 0;
+
+    bool match = false;
+    if (controller == NULL) {
+      match = controllers[0] == 0;
+    } else {
+      char* state;
+      for (char* c = strtok_r(controllers, ",", &state);
+           c != NULL;
+           c = strtok_r(NULL, ",", &state)) {
+        if (strcmp(c, controller) == 0) {
+          match = true;
+          break;
+        }
+      }
+    }
+    if (match) {
+      snprintf(path, size, "%s", cgroup);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// Calls visit with the directory of this process's cgroup and of each of its
+// ancestors, since a limit on any of them applies. The cgroup may not be
+// visible from inside a container's mount namespace, in which case only the
+// directories that exist are useful.
+template <typename Visitor>
+static void VisitCgroups(const char* controller, Visitor visit) {
+  char cgroup[1024];
+  if (!FindCgroup(controller, cgroup, sizeof(cgroup))) {
+    return;
+  }
+  for (;;) {
+    char directory[2048];
+    if (controller == NULL) {
+      snprintf(directory, sizeof(directory), "%s%s", kCgroupRoot, cgroup);
+    } else {
+      snprintf(directory, sizeof(directory), "%s/%s%s",
+               kCgroupRoot, controller, cgroup);
+    }
+    visit(directory);
+    char* last = strrchr(cgroup, '/');
+    if (last == NULL) {
+      return;
+    }
+    *last = 0;
+  }
+}
+
+
+// Answers -1 if the file is missing or holds no limit ("max" or "-1").
+static int64_t ReadCgroupValue(const char* directory, const char* file) {
+  char path[2200];
+  char contents[128];
+  snprintf(path, sizeof(path), "%s/%s", directory, file);
+  if (!ReadFile(path, contents, sizeof(contents))) {
+    return -1;
+  }
+  char* end;
+  long long value = strtoll(contents, &end, 10);  // NOLINT
+  if ((end == contents) || (value < 0)) {
+    return -1;
+  }
+  return value;
+}
+
+
+static intptr_t ComputeAvailableProcessors() {
+  intptr_t processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+  // Covers cpusets.
+  cpu_set_t affinity;
+  if (sched_getaffinity(0, sizeof(affinity), &affinity) == 0) {
+    intptr_t count = CPU_COUNT(&affinity);
+    if ((count > 0) && (count < processors)) {
+      processors = count;
+    }
+  }
+
+  // CFS bandwidth quotas, rounded up to whole processors.
+  auto limit_to_quota = [&](int64_t quota, int64_t period) {
+    if ((quota > 0) && (period > 0)) {
+      intptr_t count = (quota + period - 1) / period;
+      if (count < processors) {
+        processors = count;
+      }
+    }
+  };
+  VisitCgroups(NULL, [&](const char* directory) {
+    char path[2200];
+    char contents[128];
+    snprintf(path, sizeof(path), "%s/cpu.max", directory);
+    long long quota, period;  // NOLINT
+    if (ReadFile(path, contents, sizeof(contents)) &&
+        (sscanf(contents, "%lld %lld", &quota, &period) == 2)) {
+      limit_to_quota(quota, period);
+    }
+  });
+  VisitCgroups("cpu", [&](const char* directory) {
+    limit_to_quota(ReadCgroupValue(directory, "cpu.cfs_quota_us"),
+                   ReadCgroupValue(directory, "cpu.cfs_period_us"));
+  });
+
+  return processors < 1 ? 1 : processors;
+}
+
+
+static int64_t ComputeMemoryLimit() {
+  int64_t limit = static_cast<int64_t>(sysconf(_SC_PHYS_PAGES)) *
+      static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+  auto limit_to = [&](int64_t value) {
+    if ((value > 0) && ((limit <= 0) || (value < limit))) {
+      limit = value;
+    }
+  };
+  VisitCgroups(NULL, [&](const char* directory) {
+    limit_to(ReadCgroupValue(directory, "memory.max"));
+  });
+  VisitCgroups("memory", [&](const char* directory) {
+    limit_to(ReadCgroupValue(directory, "memory.limit_in_bytes"));
+  });
+  return limit < 0 ? 0 : limit;
+}
+
+
+void OS::Startup() {
+  available_processors_ = ComputeAvailableProcessors();
+  memory_limit_ = ComputeMemoryLimit();
+}
 void OS::Shutdown() {}
 
 
@@ -41,7 +209,12 @@ const char* OS::Name() { return "linux"; }
 
 
 intptr_t OS::NumberOfAvailableProcessors() {
-  return sysconf(_SC_NPROCESSORS_ONLN);
+  return available_processors_;
+}
+
+
+int64_t OS::MemoryLimit() {
+  return memory_limit_;
 }
 
 
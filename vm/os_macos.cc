@@ -12,6 +12,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/sysctl.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -38,6 +39,16 @@ intptr_t OS::NumberOfAvailableProcessors() {
 }
 
 
+int64_t OS::MemoryLimit() {
+  int64_t memsize = 0;
+  size_t length = sizeof(memsize);
+  if (sysctlbyname("hw.memsize", &memsize, &length, NULL, 0) != 0) {
+    return 0;
+  }
+  return memsize;
+}
+
+
 void OS::DebugBreak() {
   __builtin_trap();
 }
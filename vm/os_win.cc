@@ -62,6 +62,16 @@ intptr_t OS::NumberOfAvailableProcessors() {
 }
 
 
+int64_t OS::MemoryLimit() {
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if (!GlobalMemoryStatusEx(&status)) {
+    return 0;
+  }
+  return static_cast<int64_t>(status.ullTotalPhys);
+}
+
+
 void OS::DebugBreak() {
 #if defined(_MSC_VER)
   // Microsoft Visual C/C++ or drop-in replacement.
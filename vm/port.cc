@@ -32,7 +32,7 @@ intptr_t PortMap::FindPort(Port port) {
     return -1;
   }
   ASSERT(port != ILLEGAL_PORT);
-  intptr_t index = port % capacity_;
+  intptr_t index = static_cast<uint64_t>(port) % capacity_;
   intptr_t start_index = index;
   Entry entry = map_[index];
   while (entry.loop != NULL) {
@@ -56,7 +56,7 @@ void PortMap::Rehash(intptr_t new_capacity) {
     Entry entry = map_[i];
     // Skip free and deleted entries.
     if (entry.port != 0) {
-      intptr_t new_index = entry.port % new_capacity;
+      intptr_t new_index = static_cast<uint64_t>(entry.port) % new_capacity;
       while (new_ports[new_index].port != 0) {
         new_index = (new_index + 1) % new_capacity;
       }
@@ -107,12 +107,14 @@ Port PortMap::CreatePort(MessageLoop* loop) {
   Entry entry;
   entry.port = AllocatePort();
   entry.loop = loop;
+  entry.priority = kNormalPriority;
   /// entry.state = kNewPort;
 
   // Search for the first unused slot. Make use of the knowledge that here is
   // currently no port with this id in the port map.
   ASSERT(FindPort(entry.port) < 0);
-  intptr_t index = entry.port % capacity_;
+  // Port ids are random and may be negative.
+  intptr_t index = static_cast<uint64_t>(entry.port) % capacity_;
   Entry cur = map_[index];
   // Stop the search at the first found unused (free or deleted) slot.
   while (cur.port != 0) {
@@ -152,11 +154,26 @@ bool PortMap::PostMessage(IsolateMessage* message) {
   MessageLoop* loop = map_[index].loop;
   ASSERT(map_[index].port != 0);
   ASSERT((loop != NULL) && (loop != deleted_entry_));
+  if (message->priority() == kPortPriority) {
+    message->set_priority(map_[index].priority);
+  }
   loop->PostMessage(message);
   return true;
 }
 
 
+bool PortMap::SetPriority(MessageLoop* loop, Port port, intptr_t priority) {
+  ASSERT((priority >= 0) && (priority < kNumMessagePriorities));
+  MutexLocker ml(mutex_);
+  intptr_t index = FindPort(port);
+  if ((index < 0) || (map_[index].loop != loop)) {
+    return false;
+  }
+  map_[index].priority = priority;
+  return true;
+}
+
+
 bool PortMap::ClosePort(Port port) {
   MutexLocker ml(mutex_);
   intptr_t index = FindPort(port);
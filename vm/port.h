@@ -22,6 +22,9 @@ class PortMap : public AllStatic {
  public:
   static Port CreatePort(MessageLoop* loop);
   static bool PostMessage(IsolateMessage* message);
+  // Sets the lane of messages sent to a port of loop without a priority of
+  // their own.
+  static bool SetPriority(MessageLoop* loop, Port port, intptr_t priority);
   static bool ClosePort(Port port);
   static void CloseAllPorts(MessageLoop* loop);
 
@@ -40,6 +43,7 @@ class PortMap : public AllStatic {
   typedef struct {
     Port port;
     MessageLoop* loop;
+    intptr_t priority;
   } Entry;
 
   static Mutex* mutex_;
@@ -13,6 +13,11 @@
 #elif defined(OS_EMSCRIPTEN)
 #include <emscripten.h>
 #endif
+#if defined(OS_WINDOWS)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "vm/assert.h"
 #include "vm/double_conversion.h"
@@ -23,6 +28,8 @@
 #include "vm/message_loop.h"
 #include "vm/object.h"
 #include "vm/os.h"
+#include "vm/shared_graph.h"
+#include "vm/snapshot.h"
 
 #define nil I->nil_obj()
 
@@ -199,6 +206,36 @@ const bool kFailure = false;
   V(165, ZXStatus_getString)                                                   \
   V(166, JS_performInstanceOf)                                                 \
   V(167, JS_performHas)                                                        \
+  V(168, share)                                                                \
+  V(169, sendShared)                                                           \
+  V(170, checkpoint)                                                           \
+  V(171, Platform_memoryLimit)                                                 \
+  V(172, BinaryStream_readInteger)                                             \
+  V(173, BinaryStream_writeInteger)                                            \
+  V(174, BinaryStream_readFloat)                                               \
+  V(175, BinaryStream_writeFloat)                                              \
+  V(176, BinaryStream_readVarint)                                              \
+  V(177, BinaryStream_writeVarint)                                             \
+  V(178, BinaryStream_readBytes)                                               \
+  V(179, BinaryStream_writeBytes)                                              \
+  V(180, Behavior_allInstancesOfAll)                                           \
+  V(181, Object_referencesToAll)                                               \
+  V(182, Array_elementsForwardIdentityMigrating)                               \
+  V(183, Scanner_scanToken)                                                    \
+  V(184, Object_perform)                                                       \
+  V(185, Forwarder_doesNotUnderstand)                                          \
+  V(186, Platform_setNewSpacePolicy)                                           \
+  V(187, spawnFromSnapshot)                                                    \
+  V(188, registerSnapshot)                                                     \
+  V(189, sendWithPriority)                                                     \
+  V(190, sendSharedWithPriority)                                               \
+  V(191, Port_setPriority)                                                     \
+  V(192, messageQueueDepth)                                                    \
+  V(193, multicast)                                                            \
+  V(194, multicastShared)                                                      \
+  V(195, Platform_newSpaceCapacity)                                            \
+  V(196, Platform_maxNewSpace)                                                 \
+  V(197, Platform_scavengePauseTarget)                                         \
   V(200, quickReturnSelf)                                                      \
   V(236, Bytes_uint8At)                                                        \
   V(237, Bytes_uint8AtPut)                                                     \
@@ -1276,6 +1313,9 @@ DEFINE_PRIMITIVE(Array_atPut) {
   if ((index < 0) || (index >= array->Size())) {
     return kFailure;
   }
+  if (array->is_shared()) {
+    return kFailure;
+  }
   Object value = I->Stack(0);
   array->set_element(index, value);
   RETURN(value);
@@ -1346,8 +1386,7 @@ DEFINE_PRIMITIVE(ByteArray_class_new) {
   if (length < 0) {
     return kFailure;
   }
-  ByteArray result = H->AllocateByteArray(length);  // SAFEPOINT
-  memset(result->element_addr(0), 0, length);
+  ByteArray result = H->AllocateZeroedByteArray(length);  // SAFEPOINT
   RETURN(result);
 }
 
@@ -1491,6 +1530,285 @@ ACCESS_FLOAT(float32, float)
 ACCESS_FLOAT(float64, double)
 #undef ACCESS_FLOAT
 
+// BinaryReadStream and BinaryWriteStream. Slot 0 is the ByteArray or String
+// being read or written and slot 1 is the position, the number of bytes
+// already consumed or produced.
+static bool StreamArguments(Object receiver, bool writable,
+                            Bytes* data, intptr_t* position) {
+  if (!receiver->IsRegularObject()) {
+    return false;
+  }
+  RegularObject stream = static_cast<RegularObject>(receiver);
+  Object raw_data = stream->slot(0);
+  Object raw_position = stream->slot(1);
+  if (writable ? !raw_data->IsByteArray() : !raw_data->IsBytes()) {
+    return false;
+  }
+  if (!raw_position->IsSmallInteger()) {
+    return false;
+  }
+  *data = static_cast<Bytes>(raw_data);
+  *position = static_cast<SmallInteger>(raw_position)->value();
+  return (*position >= 0) && (*position <= (*data)->Size());
+}
+
+static void SetStreamPosition(Object receiver, intptr_t position) {
+  static_cast<RegularObject>(receiver)->set_slot(
+      1, SmallInteger::New(position), kNoBarrier);
+}
+
+static bool IsFixedWidth(intptr_t width) {
+  return (width == 1) || (width == 2) || (width == 4) || (width == 8);
+}
+
+static uint64_t LoadBytes(const uint8_t* bytes, intptr_t width,
+                          bool big_endian) {
+  uint64_t value = 0;
+  for (intptr_t i = 0; i < width; i++) {
+    value = (value << 8) | bytes[big_endian ? i : width - 1 - i];
+  }
+  return value;
+}
+
+static void StoreBytes(uint8_t* bytes, intptr_t width, bool big_endian,
+                       uint64_t value) {
+  for (intptr_t i = 0; i < width; i++) {
+    bytes[big_endian ? width - 1 - i : i] = value & 0xFF;
+    value >>= 8;
+  }
+}
+
+DEFINE_PRIMITIVE(BinaryStream_readInteger) {
+  ASSERT(num_args == 3);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(3), false, &data, &position)) {
+    return kFailure;
+  }
+  SMI_ARGUMENT(width, 2);
+  bool is_signed = I->Stack(1) == I->true_obj();
+  bool big_endian = I->Stack(0) == I->true_obj();
+  if (!IsFixedWidth(width) || ((position + width) > data->Size())) {
+    return kFailure;
+  }
+  uint64_t value =
+      LoadBytes(data->element_addr(position), width, big_endian);
+  SetStreamPosition(I->Stack(3), position + width);
+  if (!is_signed) {
+    RETURN(LargeInteger::FromUint64(value, H));  // SAFEPOINT
+  }
+  intptr_t shift = (sizeof(uint64_t) - width) * kBitsPerByte;
+  int64_t signed_value = static_cast<int64_t>(value << shift) >> shift;
+  RETURN_MINT(signed_value);
+}
+
+DEFINE_PRIMITIVE(BinaryStream_writeInteger) {
+  ASSERT(num_args == 4);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(4), true, &data, &position)) {
+    return kFailure;
+  }
+  SMI_ARGUMENT(width, 2);
+  bool is_signed = I->Stack(1) == I->true_obj();
+  bool big_endian = I->Stack(0) == I->true_obj();
+  if (!IsFixedWidth(width) || ((position + width) > data->Size())) {
+    return kFailure;
+  }
+  intptr_t bits = width * kBitsPerByte;
+  uint64_t value;
+  if (is_signed) {
+    MINT_ARGUMENT(signed_value, 3);
+    if (width < 8) {
+      int64_t limit = static_cast<int64_t>(1) << (bits - 1);
+      if ((signed_value < -limit) || (signed_value >= limit)) {
+        return kFailure;
+      }
+    }
+    value = static_cast<uint64_t>(signed_value);
+  } else {
+    if (!LargeInteger::AsUint64(I->Stack(3), &value)) {
+      return kFailure;
+    }
+    if ((width < 8) && ((value >> bits) != 0)) {
+      return kFailure;
+    }
+  }
+  StoreBytes(data->element_addr(position), width, big_endian, value);
+  SetStreamPosition(I->Stack(4), position + width);
+  RETURN(I->Stack(3));
+}
+
+DEFINE_PRIMITIVE(BinaryStream_readFloat) {
+  ASSERT(num_args == 2);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(2), false, &data, &position)) {
+    return kFailure;
+  }
+  SMI_ARGUMENT(width, 1);
+  bool big_endian = I->Stack(0) == I->true_obj();
+  if (((width != 4) && (width != 8)) ||
+      ((position + width) > data->Size())) {
+    return kFailure;
+  }
+  uint64_t bits = LoadBytes(data->element_addr(position), width, big_endian);
+  SetStreamPosition(I->Stack(2), position + width);
+  double value;
+  if (width == 4) {
+    uint32_t bits32 = static_cast<uint32_t>(bits);
+    float value32;
+    memcpy(&value32, &bits32, sizeof(value32));
+    value = value32;
+  } else {
+    memcpy(&value, &bits, sizeof(value));
+  }
+  RETURN_FLOAT(value);
+}
+
+DEFINE_PRIMITIVE(BinaryStream_writeFloat) {
+  ASSERT(num_args == 3);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(3), true, &data, &position)) {
+    return kFailure;
+  }
+  FLOAT_ARGUMENT(value, 2);
+  SMI_ARGUMENT(width, 1);
+  bool big_endian = I->Stack(0) == I->true_obj();
+  if (((width != 4) && (width != 8)) ||
+      ((position + width) > data->Size())) {
+    return kFailure;
+  }
+  uint64_t bits;
+  if (width == 4) {
+    float value32 = static_cast<float>(value);
+    uint32_t bits32;
+    memcpy(&bits32, &value32, sizeof(bits32));
+    bits = bits32;
+  } else {
+    memcpy(&bits, &value, sizeof(bits));
+  }
+  StoreBytes(data->element_addr(position), width, big_endian, bits);
+  SetStreamPosition(I->Stack(3), position + width);
+  RETURN(I->Stack(2));
+}
+
+// LEB128, optionally zigzag encoded. Values that do not fit in 64 bits fail
+// to the Newspeak implementation.
+DEFINE_PRIMITIVE(BinaryStream_readVarint) {
+  ASSERT(num_args == 1);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(1), false, &data, &position)) {
+    return kFailure;
+  }
+  bool zigzag = I->Stack(0) == I->true_obj();
+  uint64_t value = 0;
+  intptr_t shift = 0;
+  for (;;) {
+    if (position >= data->Size()) {
+      return kFailure;
+    }
+    uint8_t byte = data->element(position++);
+    uint64_t payload = byte & 0x7F;
+    if ((shift == 63) ? (payload > 1) : (shift > 63)) {
+      return kFailure;
+    }
+    value |= payload << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+    shift += 7;
+  }
+  SetStreamPosition(I->Stack(1), position);
+  if (!zigzag) {
+    RETURN(LargeInteger::FromUint64(value, H));  // SAFEPOINT
+  }
+  int64_t decoded = static_cast<int64_t>(value >> 1) ^
+      -static_cast<int64_t>(value & 1);
+  RETURN_MINT(decoded);
+}
+
+DEFINE_PRIMITIVE(BinaryStream_writeVarint) {
+  ASSERT(num_args == 2);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(2), true, &data, &position)) {
+    return kFailure;
+  }
+  MINT_ARGUMENT(raw_value, 1);
+  bool zigzag = I->Stack(0) == I->true_obj();
+  uint64_t value;
+  if (zigzag) {
+    value = (static_cast<uint64_t>(raw_value) << 1) ^
+        static_cast<uint64_t>(raw_value >> 63);
+  } else if (raw_value < 0) {
+    return kFailure;
+  } else {
+    value = raw_value;
+  }
+  intptr_t length = 1;
+  for (uint64_t v = value >> 7; v != 0; v >>= 7) {
+    length++;
+  }
+  if ((position + length) > data->Size()) {
+    return kFailure;
+  }
+  uint8_t* cursor = data->element_addr(position);
+  while (value > 0x7F) {
+    *cursor++ = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  *cursor = value;
+  SetStreamPosition(I->Stack(2), position + length);
+  RETURN(I->Stack(1));
+}
+
+DEFINE_PRIMITIVE(BinaryStream_readBytes) {
+  ASSERT(num_args == 2);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(2), false, &data, &position)) {
+    return kFailure;
+  }
+  SMI_ARGUMENT(count, 1);
+  bool as_string = I->Stack(0) == I->true_obj();
+  if ((count < 0) || ((position + count) > data->Size())) {
+    return kFailure;
+  }
+  Bytes result;
+  if (as_string) {
+    result = H->AllocateString(count);  // SAFEPOINT
+  } else {
+    result = H->AllocateByteArray(count);  // SAFEPOINT
+  }
+  data = static_cast<Bytes>(static_cast<RegularObject>(I->Stack(2))->slot(0));
+  memcpy(result->element_addr(0), data->element_addr(position), count);
+  SetStreamPosition(I->Stack(2), position + count);
+  RETURN(result);
+}
+
+DEFINE_PRIMITIVE(BinaryStream_writeBytes) {
+  ASSERT(num_args == 1);
+  Bytes data;
+  intptr_t position;
+  if (!StreamArguments(I->Stack(1), true, &data, &position)) {
+    return kFailure;
+  }
+  if (!I->Stack(0)->IsBytes()) {
+    return kFailure;
+  }
+  Bytes bytes = static_cast<Bytes>(I->Stack(0));
+  intptr_t count = bytes->Size();
+  if ((position + count) > data->Size()) {
+    return kFailure;
+  }
+  memmove(data->element_addr(position), bytes->element_addr(0), count);
+  SetStreamPosition(I->Stack(1), position + count);
+  RETURN(I->Stack(0));
+}
+
 DEFINE_PRIMITIVE(Bytes_copyByteArrayFromTo) {
   ASSERT(num_args == 2);
 
@@ -1567,6 +1885,9 @@ DEFINE_PRIMITIVE(Array_replaceFromToWithStartingAt) {
   if (!receiver->IsArray()) {
     UNREACHABLE();
   }
+  if (receiver->is_shared()) {
+    return kFailure;
+  }
   SMI_ARGUMENT(start, 3);
   SMI_ARGUMENT(stop, 2);
   Array replacement = static_cast<Array>(I->Stack(1));
@@ -1596,18 +1917,7 @@ DEFINE_PRIMITIVE(Array_replaceFromToWithStartingAt) {
   }
 
   // Note replacement may be receiver.
-  if (replacementStart < start) {
-    for (intptr_t i = count - 1; i >= 0; i--) {
-      receiver->set_element(start - 1 + i,
-                            replacement->element(replacementStart - 1 + i));
-    }
-  } else {
-    for (intptr_t i = 0; i < count; i++) {
-      receiver->set_element(start - 1 + i,
-                            replacement->element(replacementStart - 1 + i));
-    }
-  }
-
+  receiver->CopyElements(start - 1, replacement, replacementStart - 1, count);
   RETURN_SELF();
 }
 
@@ -1632,9 +1942,7 @@ DEFINE_PRIMITIVE(Array_copyFromTo) {
 
   Array result = H->AllocateArray(subsize);  // SAFEPOINT
   array = static_cast<Array>(I->Stack(2));
-  for (intptr_t i = 0; i < subsize; i++) {
-    result->set_element(i, array->element(i + start - 1));
-  }
+  result->CopyElements(0, array, start - 1, subsize);
   RETURN(result);
 }
 
@@ -2051,8 +2359,7 @@ DEFINE_PRIMITIVE(Object_identityHash) {
       hash = 1;
     }
   } else if (receiver->IsString()) {
-    static_cast<String>(receiver)->EnsureHash(I->isolate());
-    hash = static_cast<String>(receiver)->header_hash();
+    hash = static_cast<String>(receiver)->EnsureHash(I->isolate())->value();
   } else {
     hash = static_cast<HeapObject>(receiver)->header_hash();
     if (hash == 0) {
@@ -2060,6 +2367,8 @@ DEFINE_PRIMITIVE(Object_identityHash) {
       if (hash == 0) {
         hash = 1;
       }
+      // Shared objects other than Strings are given a hash when copied.
+      ASSERT(!static_cast<HeapObject>(receiver)->is_shared());
       static_cast<HeapObject>(receiver)->set_header_hash(hash);
     }
   }
@@ -2085,6 +2394,25 @@ DEFINE_PRIMITIVE(Object_performWithAll) {
 }
 
 
+// Message send:to:with:..., which keeps the selector, receiver and arguments on
+// the stack instead of collecting them into a Message and an Array.
+DEFINE_PRIMITIVE(Object_perform) {
+  ASSERT(num_args >= 2);
+  if (!I->PerformStacked(num_args - 2)) {  // SAFEPOINT
+    return kFailure;
+  }
+  return kSuccess;
+}
+
+
+// Only marks a Forwarder's handler, which Interpreter::DNUSend bypasses by
+// resending to the target. Invoked with a materialized Message, it fails so the
+// handler's body forwards it.
+DEFINE_PRIMITIVE(Forwarder_doesNotUnderstand) {
+  return kFailure;
+}
+
+
 DEFINE_PRIMITIVE(Closure_value0) {
   ASSERT(num_args == 0);
   Closure closure = static_cast<Closure>(I->Stack(num_args));
@@ -2185,6 +2513,31 @@ DEFINE_PRIMITIVE(Object_referencesTo) {
   RETURN(result);
 }
 
+DEFINE_PRIMITIVE(Behavior_allInstancesOfAll) {
+  ASSERT(num_args == 1);
+  if (!I->Stack(0)->IsArray()) {
+    return kFailure;
+  }
+  Array classes = static_cast<Array>(I->Stack(0));
+  for (intptr_t i = 0; i < classes->Size(); i++) {
+    if (!classes->element(i)->IsRegularObject()) {
+      return kFailure;
+    }
+  }
+  Array result = H->InstancesOfAll(classes);  // SAFEPOINT
+  RETURN(result);
+}
+
+DEFINE_PRIMITIVE(Object_referencesToAll) {
+  ASSERT(num_args == 1);
+  if (!I->Stack(0)->IsArray()) {
+    return kFailure;
+  }
+  Array targets = static_cast<Array>(I->Stack(0));
+  Array result = H->ReferencesToAll(targets);  // SAFEPOINT
+  RETURN(result);
+}
+
 DEFINE_PRIMITIVE(Object_heapSize) {
   ASSERT(num_args == 1);
   Object target = I->Stack(0);
@@ -2207,10 +2560,487 @@ DEFINE_PRIMITIVE(Array_elementsForwardIdentity) {
   return kFailure;
 }
 
+// Like Array_elementsForwardIdentity, but instances of classes whose shape
+// changes are migrated lazily instead of by the caller. migrations is a flat
+// array of triples: an old class, the new class, and for each slot of the new
+// class the 1-based index of the old slot to copy or 0 for nil.
+DEFINE_PRIMITIVE(Array_elementsForwardIdentityMigrating) {
+  ASSERT(num_args == 3);
+  Array left = static_cast<Array>(I->Stack(2));
+  Array right = static_cast<Array>(I->Stack(1));
+  Array migrations = static_cast<Array>(I->Stack(0));
+  if (!left->IsArray() || !right->IsArray() || !migrations->IsArray()) {
+    return kFailure;
+  }
+  intptr_t length = migrations->Size();
+  if ((length % 3) != 0) {
+    return kFailure;
+  }
+  for (intptr_t i = 0; i < length; i += 3) {
+    Behavior old_class = static_cast<Behavior>(migrations->element(i));
+    Behavior new_class = static_cast<Behavior>(migrations->element(i + 1));
+    Array slot_map = static_cast<Array>(migrations->element(i + 2));
+    if (!old_class->IsRegularObject() || !new_class->IsRegularObject() ||
+        !slot_map->IsArray()) {
+      return kFailure;
+    }
+    old_class->AssertCouldBeBehavior();
+    new_class->AssertCouldBeBehavior();
+    if (!old_class->format()->IsSmallInteger() ||
+        (new_class->format() != SmallInteger::New(slot_map->Size()))) {
+      return kFailure;
+    }
+    intptr_t old_slots = old_class->format()->value();
+    for (intptr_t j = 0; j < slot_map->Size(); j++) {
+      SmallInteger old_index = static_cast<SmallInteger>(slot_map->element(j));
+      if (!old_index->IsSmallInteger() ||
+          (old_index->value() < 0) ||
+          (old_index->value() > old_slots)) {
+        return kFailure;
+      }
+    }
+  }
+
+  // Each old class with instances is replaced by a copy that takes over its
+  // id, so the old class itself can be forwarded like any other.
+  Array table = H->AllocateArray(length);  // SAFEPOINT
+  migrations = static_cast<Array>(I->Stack(0));
+  for (intptr_t i = 0; i < length; i++) {
+    table->set_element(i, migrations->element(i));
+  }
+  HandleScope h1(H, reinterpret_cast<Object*>(&table));
+  for (intptr_t i = 0; i < length; i += 3) {
+    RegularObject old_class = static_cast<RegularObject>(table->element(i));
+    if (static_cast<Behavior>(old_class)->id() == nil) {
+      table->set_element(i, nil);
+    } else {
+      intptr_t num_slots = (old_class->HeapSize() -
+                            sizeof(HeapObject::Layout)) / sizeof(Object);
+      RegularObject migration_class =
+          H->AllocateRegularObject(old_class->cid(), num_slots);  // SAFEPOINT
+      old_class = static_cast<RegularObject>(table->element(i));
+      for (intptr_t j = 0; j < num_slots; j++) {
+        migration_class->set_slot(j, old_class->slot(j));
+      }
+      table->set_element(i, migration_class);
+    }
+
+    Behavior new_class = static_cast<Behavior>(table->element(i + 1));
+    if (new_class->id() == nil) {
+      intptr_t cid = H->AllocateClassId();  // SAFEPOINT
+      new_class = static_cast<Behavior>(table->element(i + 1));
+      H->RegisterClass(cid, new_class);
+    }
+  }
+
+  left = static_cast<Array>(I->Stack(2));
+  right = static_cast<Array>(I->Stack(1));
+  if (H->BecomeForward(left, right, table)) {
+    RETURN_SELF();
+  }
+  return kFailure;
+}
+
+
+// The token rules of NewspeakPredictiveParsing's Scanner. Anything the
+// Newspeak scanner evaluates to a non-SmallInteger number, and every scan
+// error, is left to it by failing.
+enum ScannedKind {
+  kUnscannedToken = 0,
+  kIdentifierToken,
+  kKeywordToken,
+  kSetterToken,
+  kBinaryToken,
+  kEventualSendToken,
+  kNumberToken,
+  kStringToken,
+  kSymbolToken,
+  kCharacterToken,
+  kColonToken,
+  kAssignToken,
+  kLeftParenToken,
+  kRightParenToken,
+  kPeriodToken,
+  kSemicolonToken,
+  kLeftBracketToken,
+  kRightBracketToken,
+  kCaretToken,
+  kLeftBraceToken,
+  kRightBraceToken,
+  kEndToken,
+};
+
+// Positions are 0-based. A string value is the input in
+// [value_start, value_end), with doubled quotes collapsed if escaped.
+struct ScannedToken {
+  intptr_t position;
+  intptr_t start;
+  intptr_t extended_start;
+  intptr_t value_start;
+  intptr_t value_end;
+  intptr_t value_length;
+  bool escaped;
+  bool has_number;
+  intptr_t number;
+};
+
+static bool IsScannerLetter(uint8_t byte) {
+  return ((byte >= 'a') && (byte <= 'z')) ||
+      ((byte >= 'A') && (byte <= 'Z')) ||
+      (byte == '_');
+}
+
+static bool IsScannerDigit(uint8_t byte) {
+  return (byte >= '0') && (byte <= '9');
+}
+
+static bool IsScannerAlphanumeric(uint8_t byte) {
+  return IsScannerLetter(byte) || IsScannerDigit(byte);
+}
+
+static bool IsScannerExtendedDigit(uint8_t byte) {
+  return IsScannerDigit(byte) || ((byte >= 'A') && (byte <= 'Z'));
+}
+
+static bool IsScannerSpecial(uint8_t byte) {
+  switch (byte) {
+  case '!': case '%': case '&': case '*': case '+': case ',': case '-':
+  case '/': case '<': case '=': case '>': case '?': case '@': case '\\':
+  case '|': case '~':
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool IsCommentStart(const uint8_t* in, intptr_t size, intptr_t pos) {
+  return ((pos + 1) < size) && (in[pos] == '(') && (in[pos + 1] == '*');
+}
+
+// Answers the position after the comment starting at pos, or -1 if it is
+// unterminated.
+static intptr_t SkipScannerComment(const uint8_t* in, intptr_t size,
+                                   intptr_t pos) {
+  intptr_t depth = 0;
+  while ((pos + 1) < size) {
+    if ((in[pos] == '*') && (in[pos + 1] == ')')) {
+      pos += 2;
+      if (--depth == 0) {
+        return pos;
+      }
+    } else if (IsCommentStart(in, size, pos)) {
+      pos += 2;
+      depth++;
+    } else {
+      pos++;
+    }
+  }
+  return -1;
+}
+
+static void SetScannedRange(ScannedToken* token,
+                            intptr_t start, intptr_t end) {
+  token->value_start = start;
+  token->value_end = end;
+  token->value_length = end - start;
+}
+
+// Scans the body of a string literal whose opening quote is just before
+// token->position.
+static bool ScanStringBody(const uint8_t* in, intptr_t size,
+                           ScannedToken* token) {
+  intptr_t pos = token->position;
+  intptr_t start = pos;
+  intptr_t escapes = 0;
+  while (pos < size) {
+    if (in[pos] == '\'') {
+      pos++;
+      if ((pos >= size) || (in[pos] != '\'')) {
+        SetScannedRange(token, start, pos - 1);
+        token->value_length -= escapes;
+        token->escaped = escapes != 0;
+        token->position = pos;
+        return true;
+      }
+      escapes++;
+    }
+    pos++;
+  }
+  return false;
+}
+
+static ScannedKind ScanSymbol(const uint8_t* in, intptr_t size,
+                              ScannedToken* token) {
+  intptr_t pos = token->position;
+  if (pos >= size) {
+    return kUnscannedToken;
+  }
+  uint8_t byte = in[pos++];
+  if (byte == '\'') {
+    token->position = pos;
+    return ScanStringBody(in, size, token) ? kSymbolToken : kUnscannedToken;
+  }
+  if (IsScannerSpecial(byte)) {
+    while ((pos < size) && IsScannerSpecial(in[pos])) {
+      pos++;
+    }
+    if ((pos < size) && (in[pos] == ':')) {
+      // Whether the colon belongs to the symbol, as in #<-:, is left to the
+      // Newspeak scanner.
+      return kUnscannedToken;
+    }
+  } else if (IsScannerLetter(byte)) {
+    while ((pos < size) && IsScannerAlphanumeric(in[pos])) {
+      pos++;
+    }
+    if ((pos < size) && (in[pos] == ':')) {
+      pos++;
+      while ((pos < size) && IsScannerAlphanumeric(in[pos])) {
+        while ((pos < size) && IsScannerAlphanumeric(in[pos])) {
+          pos++;
+        }
+        if ((pos >= size) || (in[pos] != ':')) {
+          return kUnscannedToken;
+        }
+        pos++;
+      }
+    }
+  } else {
+    return kUnscannedToken;
+  }
+  SetScannedRange(token, token->start + 1, pos);
+  token->position = pos;
+  return kSymbolToken;
+}
+
+static ScannedKind ScanNumber(const uint8_t* in, intptr_t size,
+                              ScannedToken* token) {
+  intptr_t pos = token->position;
+  intptr_t value = in[pos - 1] - '0';
+  while ((pos < size) && IsScannerDigit(in[pos])) {
+    intptr_t digit = in[pos] - '0';
+    if (value > ((SmallInteger::kMaxValue - digit) / 10)) {
+      return kUnscannedToken;
+    }
+    value = value * 10 + digit;
+    pos++;
+  }
+  if ((pos + 1) < size) {
+    // Radix, fraction or exponent.
+    if ((in[pos] == 'r') && IsScannerExtendedDigit(in[pos + 1])) {
+      return kUnscannedToken;
+    }
+    if ((in[pos] == '.') && IsScannerExtendedDigit(in[pos + 1])) {
+      return kUnscannedToken;
+    }
+    if ((in[pos] == 'e') &&
+        (IsScannerDigit(in[pos + 1]) ||
+         ((in[pos + 1] == '-') && ((pos + 2) < size) &&
+          IsScannerDigit(in[pos + 2])))) {
+      return kUnscannedToken;
+    }
+  }
+  token->has_number = true;
+  token->number = value;
+  token->position = pos;
+  return kNumberToken;
+}
+
+static ScannedKind ScanToken(const uint8_t* in, intptr_t size,
+                             ScannedToken* token) {
+  intptr_t pos = token->position;
+  token->extended_start = -1;
+  for (;;) {
+    intptr_t previous = pos;
+    while ((pos < size) && (in[pos] <= ' ')) {
+      pos++;
+    }
+    if (IsCommentStart(in, size, pos)) {
+      if (token->extended_start == -1) {
+        token->extended_start = pos;
+      }
+      pos = SkipScannerComment(in, size, pos);
+      if (pos == -1) {
+        return kUnscannedToken;
+      }
+    }
+    if (pos == previous) {
+      break;
+    }
+  }
+  if (token->extended_start == -1) {
+    token->extended_start = pos;
+  }
+
+  token->start = pos;
+  if (pos >= size) {
+    token->position = pos;
+    return kEndToken;
+  }
+  uint8_t byte = in[pos++];
+  token->position = pos;
+
+  if (IsScannerLetter(byte)) {
+    while ((pos < size) && IsScannerAlphanumeric(in[pos])) {
+      pos++;
+    }
+    if ((pos < size) && (in[pos] == ':')) {
+      SetScannedRange(token, token->start, pos + 1);
+      if (((pos + 1) < size) && (in[pos + 1] == ':')) {
+        token->position = pos + 2;
+        return kSetterToken;
+      }
+      token->position = pos + 1;
+      return kKeywordToken;
+    }
+    SetScannedRange(token, token->start, pos);
+    token->position = pos;
+    return kIdentifierToken;
+  }
+  if (IsScannerSpecial(byte)) {
+    while ((pos < size) && IsScannerSpecial(in[pos])) {
+      pos++;
+    }
+    token->position = pos;
+    if (((pos - token->start) == 2) &&
+        (in[token->start] == '<') && (in[token->start + 1] == '-') &&
+        (pos < size) && (in[pos] == ':')) {
+      token->position = pos + 1;
+      return kEventualSendToken;
+    }
+    SetScannedRange(token, token->start, pos);
+    return kBinaryToken;
+  }
+  if (IsScannerDigit(byte)) {
+    return ScanNumber(in, size, token);
+  }
+
+  switch (byte) {
+  case ':':
+    if (((pos + 1) < size) && (in[pos] == ':') && (in[pos + 1] == '=')) {
+      token->position = pos + 2;
+      return kAssignToken;
+    }
+    return kColonToken;
+  case '"':
+    if (((pos + 1) < size) && (in[pos + 1] == '"')) {
+      SetScannedRange(token, pos, pos + 1);
+      token->position = pos + 2;
+      return kCharacterToken;
+    }
+    return kUnscannedToken;
+  case '#':
+    return ScanSymbol(in, size, token);
+  case '\'':
+    return ScanStringBody(in, size, token) ? kStringToken : kUnscannedToken;
+  case '(': return kLeftParenToken;
+  case ')': return kRightParenToken;
+  case '.': return kPeriodToken;
+  case ';': return kSemicolonToken;
+  case '[': return kLeftBracketToken;
+  case ']': return kRightBracketToken;
+  case '^': return kCaretToken;
+  case '{': return kLeftBraceToken;
+  case '}': return kRightBraceToken;
+  default:
+    return kUnscannedToken;
+  }
+}
+
+// Scans the token at the 1-based position start of input. Answers the kind as
+// an index into the Scanner's table of kind symbols, and fills result with
+// the token's start, the position after it, its extended start and its value.
+DEFINE_PRIMITIVE(Scanner_scanToken) {
+  ASSERT(num_args == 3);
+  if (!I->Stack(2)->IsString() || !I->Stack(0)->IsArray()) {
+    return kFailure;
+  }
+  String input = static_cast<String>(I->Stack(2));
+  SMI_ARGUMENT(start, 1);
+  if ((start < 1) || (start > (input->Size() + 1)) ||
+      (static_cast<Array>(I->Stack(0))->Size() != 4)) {
+    return kFailure;
+  }
+
+  ScannedToken token;
+  token.position = start - 1;
+  token.value_start = -1;
+  token.escaped = false;
+  token.has_number = false;
+  ScannedKind kind = ScanToken(input->element_addr(0), input->Size(), &token);
+  if (kind == kUnscannedToken) {
+    return kFailure;
+  }
+
+  Object value = nil;
+  if (token.has_number) {
+    value = SmallInteger::New(token.number);
+  } else if (token.value_start != -1) {
+    String string = H->AllocateString(token.value_length);  // SAFEPOINT
+    input = static_cast<String>(I->Stack(2));
+    const uint8_t* cursor = input->element_addr(token.value_start);
+    uint8_t* out = string->element_addr(0);
+    for (intptr_t i = 0; i < token.value_length; i++) {
+      uint8_t byte = *cursor++;
+      if (token.escaped && (byte == '\'')) {
+        cursor++;
+      }
+      *out++ = byte;
+    }
+    value = string;
+  }
+
+  Array result = static_cast<Array>(I->Stack(0));
+  result->set_element(0, SmallInteger::New(token.start + 1), kNoBarrier);
+  result->set_element(1, SmallInteger::New(token.position + 1), kNoBarrier);
+  result->set_element(2, SmallInteger::New(token.extended_start + 1),
+                      kNoBarrier);
+  result->set_element(3, value);
+  RETURN_SMI(kind);
+}
+
+
 DEFINE_PRIMITIVE(Platform_numberOfProcessors) {
   RETURN_SMI(OS::NumberOfAvailableProcessors());
 }
 
+DEFINE_PRIMITIVE(Platform_memoryLimit) {
+  int64_t limit = OS::MemoryLimit();
+  RETURN_MINT(limit);
+}
+
+// Pause target in microseconds and maximum semispace size in bytes.
+DEFINE_PRIMITIVE(Platform_setNewSpacePolicy) {
+  ASSERT(num_args == 2);
+  SmallInteger pause_target = static_cast<SmallInteger>(I->Stack(1));
+  SmallInteger max_capacity = static_cast<SmallInteger>(I->Stack(0));
+  if (!pause_target->IsSmallInteger() || !max_capacity->IsSmallInteger() ||
+      (pause_target->value() > kMaxInt64 / kNanosecondsPerMicrosecond) ||
+      (max_capacity->value() < 0)) {
+    return kFailure;
+  }
+  if (!H->SetNewSpacePolicy(pause_target->value() * kNanosecondsPerMicrosecond,
+                            max_capacity->value())) {
+    return kFailure;
+  }
+  RETURN_SELF();
+}
+
+DEFINE_PRIMITIVE(Platform_newSpaceCapacity) {
+  ASSERT(num_args == 0);
+  RETURN_SMI(H->semispace_capacity());
+}
+
+DEFINE_PRIMITIVE(Platform_maxNewSpace) {
+  ASSERT(num_args == 0);
+  RETURN_SMI(H->max_semispace_capacity());
+}
+
+DEFINE_PRIMITIVE(Platform_scavengePauseTarget) {
+  ASSERT(num_args == 0);
+  RETURN_SMI(H->scavenge_pause_target() / kNanosecondsPerMicrosecond);
+}
+
 DEFINE_PRIMITIVE(Platform_operatingSystem) {
   const char* name = OS::Name();
   intptr_t length = strlen(name);
@@ -2714,6 +3544,9 @@ DEFINE_PRIMITIVE(Object_markCanonical) {
   ASSERT(num_args == 1);
   Object object = I->Stack(0);
   if (object->IsHeapObject()) {
+    if (static_cast<HeapObject>(object)->is_shared()) {
+      return kFailure;  // Read-only, and canonical only per isolate.
+    }
     static_cast<HeapObject>(object)->set_is_canonical(true);
   } else {
     // Nop.
@@ -2722,38 +3555,79 @@ DEFINE_PRIMITIVE(Object_markCanonical) {
 }
 
 
-DEFINE_PRIMITIVE(writeBytesToFile) {
-#if defined(OS_EMSCRIPTEN)
-  return kFailure;
-#else
-  ASSERT(num_args == 2);
-  ByteArray content = static_cast<ByteArray>(I->Stack(1));
-  String filename = static_cast<String>(I->Stack(0));
-  if (!content->IsByteArray() || !filename->IsString()) {
-    return kFailure;
-  }
+#if !defined(OS_EMSCRIPTEN)
+static char* CStringFrom(String string) {
+  char* cstr = reinterpret_cast<char*>(malloc(string->Size() + 1));
+  memcpy(cstr, string->element_addr(0), string->Size());
+  cstr[string->Size()] = 0;
+  return cstr;
+}
 
-  char* raw_filename = reinterpret_cast<char*>(malloc(filename->Size() + 1));
-  memcpy(raw_filename, filename->element_addr(0), filename->Size());
-  raw_filename[filename->Size()] = 0;
-  FILE* f = fopen(raw_filename, "wb");
+
+// Answers false if the file cannot be opened or completely written. The bytes
+// are flushed to the device before the file is closed.
+static bool TryWriteBytesToFile(const char* filename,
+                                const uint8_t* bytes,
+                                size_t length) {
+  FILE* f = fopen(filename, "wb");
   if (f == NULL) {
-    FATAL("Cannot open %s\n", raw_filename);
+    return false;
   }
 
-  size_t length = content->Size();
   size_t start = 0;
   while (start != length) {
-    size_t written = fwrite(content->element_addr(start), 1, length - start, f);
+    size_t written = fwrite(bytes + start, 1, length - start, f);
     if (written == 0) {
-      FATAL("Failed to write '%s'\n", raw_filename);
+      fclose(f);
+      return false;
     }
     start += written;
   }
-  fflush(f);
-  fclose(f);
+  bool flushed = fflush(f) == 0;
+#if defined(OS_WINDOWS)
+  flushed = flushed && (_commit(_fileno(f)) == 0);
+#else
+  flushed = flushed && (fsync(fileno(f)) == 0);
+#endif
+  return (fclose(f) == 0) && flushed;
+}
+
 
+// Atomically replaces any file at to with the one at from.
+static bool RenameOver(const char* from, const char* to) {
+#if defined(OS_WINDOWS)
+  return MoveFileExA(from, to,
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return rename(from, to) == 0;
+#endif
+}
+
+
+static void WriteBytesToFile(String filename,
+                             const uint8_t* bytes,
+                             size_t length) {
+  char* raw_filename = CStringFrom(filename);
+  if (!TryWriteBytesToFile(raw_filename, bytes, length)) {
+    FATAL("Failed to write '%s'\n", raw_filename);
+  }
   free(raw_filename);
+}
+#endif
+
+
+DEFINE_PRIMITIVE(writeBytesToFile) {
+#if defined(OS_EMSCRIPTEN)
+  return kFailure;
+#else
+  ASSERT(num_args == 2);
+  ByteArray content = static_cast<ByteArray>(I->Stack(1));
+  String filename = static_cast<String>(I->Stack(0));
+  if (!content->IsByteArray() || !filename->IsString()) {
+    return kFailure;
+  }
+
+  WriteBytesToFile(filename, content->element_addr(0), content->Size());
 
   RETURN_SELF();
 #endif
@@ -2829,6 +3703,9 @@ DEFINE_PRIMITIVE(Behavior_adoptInstance) {
   ASSERT(num_args == 2);
   Behavior new_cls = static_cast<Behavior>(I->Stack(1));
   HeapObject instance = static_cast<HeapObject>(I->Stack(0));
+  if (!instance->IsHeapObject() || instance->is_shared()) {
+    return kFailure;
+  }
   Behavior old_cls = instance->Klass(H);
 
   ASSERT(old_cls->cid() >= kFirstRegularObjectCid);
@@ -2869,7 +3746,8 @@ DEFINE_PRIMITIVE(spawn) {
   ByteArray message = static_cast<ByteArray>(I->Stack(0));
   if (message->IsByteArray()) {
     intptr_t length = message->Size();
-    uint8_t* data = reinterpret_cast<uint8_t*>(malloc(length));
+    uint8_t* data =
+        reinterpret_cast<uint8_t*>(MessagePool::Allocate(length));
     memcpy(data, message->element_addr(0), length);
 
     I->isolate()->Spawn(new IsolateMessage(ILLEGAL_PORT, data, length));
@@ -2881,6 +3759,64 @@ DEFINE_PRIMITIVE(spawn) {
 }
 
 
+// Message, snapshot id or 0 for this isolate's own, then the initial and
+// maximum semispace capacities and old-space ceiling in bytes, and the class
+// table limit in ids, 0 for defaults.
+DEFINE_PRIMITIVE(spawnFromSnapshot) {
+  ASSERT(num_args == 6);
+  ByteArray message = static_cast<ByteArray>(I->Stack(5));
+  SmallInteger snapshot_id = static_cast<SmallInteger>(I->Stack(4));
+  SmallInteger initial_semispace = static_cast<SmallInteger>(I->Stack(3));
+  SmallInteger max_semispace = static_cast<SmallInteger>(I->Stack(2));
+  SmallInteger old_space_ceiling = static_cast<SmallInteger>(I->Stack(1));
+  SmallInteger class_table_limit = static_cast<SmallInteger>(I->Stack(0));
+  if (!message->IsByteArray() ||
+      !snapshot_id->IsSmallInteger() ||
+      !initial_semispace->IsSmallInteger() ||
+      !max_semispace->IsSmallInteger() ||
+      !old_space_ceiling->IsSmallInteger() ||
+      !class_table_limit->IsSmallInteger() ||
+      (initial_semispace->value() < 0) ||
+      (max_semispace->value() < 0) ||
+      (old_space_ceiling->value() < 0)) {
+    return kFailure;
+  }
+  HeapLimits limits;
+  limits.initial_semispace_capacity = initial_semispace->value();
+  limits.max_semispace_capacity = max_semispace->value();
+  limits.old_space_ceiling = old_space_ceiling->value();
+  limits.class_table_limit = class_table_limit->value();
+  if (!Heap::IsValid(limits)) {
+    return kFailure;
+  }
+
+  intptr_t length = message->Size();
+  uint8_t* data =
+      reinterpret_cast<uint8_t*>(MessagePool::Allocate(length));
+  memcpy(data, message->element_addr(0), length);
+  IsolateMessage* initial_message =
+      new IsolateMessage(ILLEGAL_PORT, data, length);
+  if (!I->isolate()->Spawn(initial_message, snapshot_id->value(), limits)) {
+    delete initial_message;
+    return kFailure;
+  }
+  RETURN_SELF();
+}
+
+
+DEFINE_PRIMITIVE(registerSnapshot) {
+  ASSERT(num_args == 1);
+  ByteArray snapshot = static_cast<ByteArray>(I->Stack(0));
+  if (!snapshot->IsByteArray() ||
+      !Deserializer::IsSnapshot(snapshot->element_addr(0), snapshot->Size())) {
+    return kFailure;
+  }
+  intptr_t id = Isolate::RegisterSnapshot(snapshot->element_addr(0),
+                                          snapshot->Size());
+  RETURN_SMI(id);
+}
+
+
 DEFINE_PRIMITIVE(send) {
   ASSERT(num_args == 2);
   MINT_ARGUMENT(port, 1);
@@ -2890,18 +3826,230 @@ DEFINE_PRIMITIVE(send) {
   }
 
   intptr_t length = data->Size();
-  uint8_t* raw_data = reinterpret_cast<uint8_t*>(malloc(length));
+  uint8_t* raw_data =
+      reinterpret_cast<uint8_t*>(MessagePool::Allocate(length));
+  memcpy(raw_data, data->element_addr(0), length);
+  IsolateMessage* message = new IsolateMessage(port, raw_data, length);
+  bool result = PortMap::PostMessage(message);
+
+  RETURN_BOOL(result);
+}
+
+
+DEFINE_PRIMITIVE(share) {
+  ASSERT(num_args == 1);
+  Object root = I->Stack(0);
+  if (!root->IsHeapObject() || static_cast<HeapObject>(root)->is_shared()) {
+    RETURN(root);
+  }
+  SharedGraph* graph =
+      SharedGraph::New(I->isolate(), static_cast<HeapObject>(root));
+  if (graph == NULL) {
+    return kFailure;
+  }
+  H->HoldSharedGraph(graph);
+  RETURN(graph->root());
+}
+
+
+DEFINE_PRIMITIVE(sendShared) {
+  ASSERT(num_args == 2);
+  MINT_ARGUMENT(port, 1);
+  HeapObject shared = static_cast<HeapObject>(I->Stack(0));
+  if (!shared->IsHeapObject() || !shared->is_shared()) {
+    return kFailure;
+  }
+
+  SharedGraph* graph = H->SharedGraphOf(shared);
+  graph->Retain();
+  IsolateMessage* message = new IsolateMessage(port, graph, shared);
+  PortMap::PostMessage(message);
+
+  // Handled even if the port is closed, so the caller does not fall back to
+  // serializing the message.
+  RETURN_BOOL(true);
+}
+
+
+static bool IsMessagePriority(Object priority) {
+  return priority->IsSmallInteger() &&
+      (static_cast<SmallInteger>(priority)->value() >= 0) &&
+      (static_cast<SmallInteger>(priority)->value() < kNumMessagePriorities);
+}
+
+
+DEFINE_PRIMITIVE(sendWithPriority) {
+  ASSERT(num_args == 3);
+  MINT_ARGUMENT(port, 2);
+  ByteArray data = static_cast<ByteArray>(I->Stack(1));
+  SmallInteger priority = static_cast<SmallInteger>(I->Stack(0));
+  if (!data->IsByteArray() || !IsMessagePriority(priority)) {
+    return kFailure;
+  }
+
+  intptr_t length = data->Size();
+  uint8_t* raw_data =
+      reinterpret_cast<uint8_t*>(MessagePool::Allocate(length));
   memcpy(raw_data, data->element_addr(0), length);
   IsolateMessage* message = new IsolateMessage(port, raw_data, length);
+  message->set_priority(priority->value());
   bool result = PortMap::PostMessage(message);
 
   RETURN_BOOL(result);
 }
 
 
+DEFINE_PRIMITIVE(sendSharedWithPriority) {
+  ASSERT(num_args == 3);
+  MINT_ARGUMENT(port, 2);
+  HeapObject shared = static_cast<HeapObject>(I->Stack(1));
+  SmallInteger priority = static_cast<SmallInteger>(I->Stack(0));
+  if (!shared->IsHeapObject() || !shared->is_shared() ||
+      !IsMessagePriority(priority)) {
+    return kFailure;
+  }
+
+  SharedGraph* graph = H->SharedGraphOf(shared);
+  graph->Retain();
+  IsolateMessage* message = new IsolateMessage(port, graph, shared);
+  message->set_priority(priority->value());
+  PortMap::PostMessage(message);
+
+  RETURN_BOOL(true);
+}
+
+
+DEFINE_PRIMITIVE(Port_setPriority) {
+  ASSERT(num_args == 2);
+  MINT_ARGUMENT(port, 1);
+  SmallInteger priority = static_cast<SmallInteger>(I->Stack(0));
+  if (!IsMessagePriority(priority) ||
+      !PortMap::SetPriority(I->isolate()->loop(), port, priority->value())) {
+    return kFailure;
+  }
+  RETURN_SELF();
+}
+
+
+DEFINE_PRIMITIVE(messageQueueDepth) {
+  ASSERT(num_args == 1);
+  SmallInteger priority = static_cast<SmallInteger>(I->Stack(0));
+  if (!IsMessagePriority(priority)) {
+    return kFailure;
+  }
+  RETURN_SMI(I->isolate()->loop()->QueueDepth(priority->value()));
+}
+
+
+// Answers false if any element of ports is not a port id.
+static bool IsPortArray(Array ports) {
+  if (!ports->IsArray()) {
+    return false;
+  }
+  for (intptr_t i = 0; i < ports->Size(); i++) {
+    Object port = ports->element(i);
+    if (!port->IsSmallInteger() && !port->IsMediumInteger()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static Port PortAt(Array ports, intptr_t index) {
+  Object port = ports->element(index);
+  if (port->IsSmallInteger()) {
+    return static_cast<SmallInteger>(port)->value();
+  }
+  return static_cast<MediumInteger>(port)->value();
+}
+
+
+DEFINE_PRIMITIVE(multicast) {
+  ASSERT(num_args == 2);
+  ByteArray data = static_cast<ByteArray>(I->Stack(1));
+  Array ports = static_cast<Array>(I->Stack(0));
+  if (!IsPortArray(ports) || !data->IsByteArray()) {
+    return kFailure;
+  }
+
+  intptr_t count = ports->Size();
+  if (count == 0) {
+    RETURN_SELF();
+  }
+  // One copy for all destinations, freed with the last message.
+  MessagePayload* payload =
+      MessagePayload::New(data->element_addr(0), data->Size(), count);
+  for (intptr_t i = 0; i < count; i++) {
+    PortMap::PostMessage(new IsolateMessage(PortAt(ports, i), payload));
+  }
+  RETURN_SELF();
+}
+
+
+DEFINE_PRIMITIVE(multicastShared) {
+  ASSERT(num_args == 2);
+  HeapObject shared = static_cast<HeapObject>(I->Stack(1));
+  Array ports = static_cast<Array>(I->Stack(0));
+  if (!IsPortArray(ports)) {
+    return kFailure;
+  }
+  if (!shared->IsHeapObject() || !shared->is_shared()) {
+    RETURN_BOOL(false);
+  }
+
+  SharedGraph* graph = H->SharedGraphOf(shared);
+  for (intptr_t i = 0; i < ports->Size(); i++) {
+    graph->Retain();
+    PortMap::PostMessage(new IsolateMessage(PortAt(ports, i), graph, shared));
+  }
+  RETURN_BOOL(true);
+}
+
+
+DEFINE_PRIMITIVE(checkpoint) {
+#if defined(OS_EMSCRIPTEN)
+  return kFailure;
+#else
+  ASSERT(num_args == 1);
+  String filename = static_cast<String>(I->Stack(0));
+  if (!filename->IsString()) {
+    return kFailure;
+  }
+
+  // Instances waiting to migrate to a new shape cannot be serialized.
+  H->FinishMigration();
+
+  // Does not allocate in the heap, so the graph cannot move underneath it.
+  Serializer serializer(H, I->isolate()->salt());
+  serializer.Serialize(I->object_store());
+
+  // Written beside the target and then renamed over it, so a crash part way
+  // through leaves the previous checkpoint intact.
+  char* raw_filename = CStringFrom(filename);
+  char* temp_filename = OS::PrintStr("%s.tmp", raw_filename);
+  bool written = TryWriteBytesToFile(temp_filename,
+                                     serializer.data(),
+                                     serializer.length()) &&
+      RenameOver(temp_filename, raw_filename);
+  if (!written) {
+    remove(temp_filename);
+  }
+  free(temp_filename);
+  free(raw_filename);
+  if (!written) {
+    return kFailure;
+  }
+
+  RETURN_SELF();
+#endif
+}
+
+
 DEFINE_PRIMITIVE(MessageLoop_finish) {
   ASSERT(num_args == 1);
   MINT_ARGUMENT(new_wakeup, 0);
+  H->MigrateSome();
   I->isolate()->loop()->MessageEpilogue(new_wakeup);
   I->ReturnFromDispatch();
   I->Exit();
@@ -2931,7 +4079,8 @@ DEFINE_PRIMITIVE(doPrimitiveWithArgs) {
       index == 93 ||  // Closure_value3
       index == 94 ||  // Closure_valueArray
       index == 95 ||  // Activation_jump
-      index == 89) {  // Object_performWithAll
+      index == 89 ||  // Object_performWithAll
+      index == 184) {  // Object_perform
     return kFailure;
   }
 
@@ -24,6 +24,7 @@ class Primitives {
 
   static bool IsUnwindProtect(intptr_t prim) { return prim == 113; }
   static bool IsSimulationRoot(intptr_t prim) { return prim == 142; }
+  static bool IsForwarder(intptr_t prim) { return prim == 185; }
 
   static bool Invoke(intptr_t prim,
                      intptr_t num_args,
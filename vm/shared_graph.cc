@@ -0,0 +1,285 @@
+// Copyright (c) 2016, the Newspeak project authors. Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/shared_graph.h"
+
+#include "vm/assert.h"
+#include "vm/isolate.h"
+#include "vm/os.h"
+
+namespace psoup {
+
+// The objects of a graph in discovery order, with an open-addressed table from
+// each object to its index so shared substructure and cycles are copied once.
+class GraphCollector {
+ public:
+  GraphCollector()
+      : objects_(NULL), size_(0), capacity_(0),
+        table_(NULL), table_mask_(0), total_size_(0) {}
+  ~GraphCollector() {
+    free(objects_);
+    free(table_);
+  }
+
+  bool Collect(HeapObject root) {
+    if (!Add(root)) {
+      return false;
+    }
+    for (intptr_t i = 0; i < size_; i++) {
+      HeapObject obj = objects_[i];
+      if (obj->IsArray()) {
+        Array array = static_cast<Array>(obj);
+        for (intptr_t j = 0; j < array->Size(); j++) {
+          Object element = array->element(j);
+          if (element->IsHeapObject() &&
+              !Add(static_cast<HeapObject>(element))) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  intptr_t size() const { return size_; }
+  intptr_t total_size() const { return total_size_; }
+  HeapObject At(intptr_t index) const { return objects_[index]; }
+  intptr_t IndexOf(HeapObject obj) const {
+    intptr_t i = Hash(obj) & table_mask_;
+    while (table_[i].object != obj) {
+      ASSERT(table_[i].object != nullptr);
+      i = (i + 1) & table_mask_;
+    }
+    return table_[i].index;
+  }
+
+ private:
+  struct Entry {
+    HeapObject object;  // nullptr if empty.
+    intptr_t index;
+  };
+
+  static intptr_t Hash(HeapObject obj) {
+    return static_cast<intptr_t>(obj->Addr() >> kObjectAlignmentLog2);
+  }
+
+  // Whether obj can be copied into a graph. Arrays qualify whether or not
+  // anything still stores into them, since only the copy is frozen.
+  static bool CanShare(HeapObject obj) {
+    switch (obj->cid()) {
+    case kMintCid:
+    case kBigintCid:
+    case kFloat64Cid:
+    case kStringCid:
+    case kArrayCid:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool Add(HeapObject obj) {
+    if ((size_ + 1) * 2 > table_mask_ + 1) {
+      Grow();
+    }
+    intptr_t i = Hash(obj) & table_mask_;
+    while (table_[i].object != nullptr) {
+      if (table_[i].object == obj) {
+        return true;
+      }
+      i = (i + 1) & table_mask_;
+    }
+    if (!CanShare(obj)) {
+      return false;
+    }
+    table_[i].object = obj;
+    table_[i].index = size_;
+    objects_[size_++] = obj;
+    total_size_ += obj->HeapSize();
+    return true;
+  }
+
+  void Grow() {
+    capacity_ = capacity_ == 0 ? 16 : capacity_ * 2;
+    objects_ = reinterpret_cast<HeapObject*>(
+        realloc(objects_, capacity_ * sizeof(HeapObject)));
+    free(table_);
+    table_ = reinterpret_cast<Entry*>(malloc(2 * capacity_ * sizeof(Entry)));
+    if ((objects_ == NULL) || (table_ == NULL)) {
+      FATAL("Failed to allocate shared graph collector\n");
+    }
+    table_mask_ = 2 * capacity_ - 1;
+    for (intptr_t i = 0; i <= table_mask_; i++) {
+      table_[i].object = nullptr;
+    }
+    for (intptr_t j = 0; j < size_; j++) {
+      intptr_t i = Hash(objects_[j]) & table_mask_;
+      while (table_[i].object != nullptr) {
+        i = (i + 1) & table_mask_;
+      }
+      table_[i].object = objects_[j];
+      table_[i].index = j;
+    }
+  }
+
+  HeapObject* objects_;
+  intptr_t size_;
+  intptr_t capacity_;
+  Entry* table_;
+  intptr_t table_mask_;
+  intptr_t total_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(GraphCollector);
+};
+
+
+SharedGraph* SharedGraph::New(Isolate* isolate, HeapObject root) {
+  GraphCollector collector;
+  if (!collector.Collect(root)) {
+    return NULL;
+  }
+
+  VirtualMemory memory =
+      VirtualMemory::Allocate(collector.total_size(),
+                              VirtualMemory::kReadWrite,
+                              "primordialsoup-shared");
+  ASSERT((memory.base() & kObjectAlignmentMask) == kOldObjectAlignmentOffset);
+
+  HeapObject* copies = new HeapObject[collector.size()];
+  uword top = memory.base();
+  for (intptr_t i = 0; i < collector.size(); i++) {
+    HeapObject original = collector.At(i);
+    intptr_t size = original->HeapSize();
+    memcpy(reinterpret_cast<void*>(top),
+           reinterpret_cast<void*>(original->Addr()),
+           size);
+    HeapObject copy = HeapObject::FromAddr(top);
+    ASSERT(copy->IsOldObject());
+    // Permanently marked so the marker never pushes or writes to it.
+    copy->set_is_marked(true);
+    copy->set_is_remembered(false);
+    // Symbols are canonicalized per isolate.
+    copy->set_is_canonical(false);
+    copy->set_is_shared(true);
+    if (!copy->IsString() && (copy->header_hash() == 0)) {
+      // String hashes are salted per isolate and so are never cached here.
+      intptr_t hash = isolate->random().NextUInt64() & SmallInteger::kMaxValue;
+      copy->set_header_hash(hash == 0 ? 1 : hash);
+    }
+    copies[i] = copy;
+    top += size;
+  }
+  ASSERT(top == memory.base() + collector.total_size());
+
+  for (intptr_t i = 0; i < collector.size(); i++) {
+    if (copies[i]->IsArray()) {
+      Array array = static_cast<Array>(copies[i]);
+      for (intptr_t j = 0; j < array->Size(); j++) {
+        Object element = array->element(j);
+        if (element->IsHeapObject()) {
+          intptr_t index =
+              collector.IndexOf(static_cast<HeapObject>(element));
+          array->set_element(j, copies[index], kNoBarrier);
+        }
+      }
+    }
+  }
+  HeapObject copied_root = copies[0];
+  delete[] copies;
+
+  memory.Protect(VirtualMemory::kReadOnly);
+  return new SharedGraph(memory, copied_root);
+}
+
+
+void SharedGraph::Release() {
+  if (refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+
+SharedGraphTable::~SharedGraphTable() {
+  for (intptr_t i = 0; i < length_; i++) {
+    entries_[i].graph->Release();
+  }
+  free(entries_);
+}
+
+
+intptr_t SharedGraphTable::UpperBound(uword addr) const {
+  intptr_t low = 0;
+  intptr_t high = length_;
+  while (low < high) {
+    intptr_t mid = low + (high - low) / 2;
+    if (entries_[mid].graph->base() <= addr) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+
+intptr_t SharedGraphTable::IndexOf(HeapObject obj) const {
+  ASSERT(obj->is_shared());
+  intptr_t index = UpperBound(obj->Addr()) - 1;
+  ASSERT(index >= 0);
+  ASSERT(entries_[index].graph->Contains(obj));
+  return index;
+}
+
+
+bool SharedGraphTable::Add(SharedGraph* graph) {
+  intptr_t index = UpperBound(graph->base());
+  if ((index > 0) && (entries_[index - 1].graph == graph)) {
+    graph->Release();
+    return false;
+  }
+  if (length_ == capacity_) {
+    capacity_ = capacity_ == 0 ? 8 : capacity_ * 2;
+    entries_ = reinterpret_cast<Entry*>(
+        realloc(entries_, capacity_ * sizeof(Entry)));
+    if (entries_ == NULL) {
+      FATAL("Failed to allocate shared graph table\n");
+    }
+  }
+  memmove(&entries_[index + 1], &entries_[index],
+          (length_ - index) * sizeof(Entry));
+  entries_[index].graph = graph;
+  // Held from now until at least the next mark-sweep.
+  entries_[index].reached = true;
+  length_++;
+  total_size_ += graph->size();
+  return true;
+}
+
+
+SharedGraph* SharedGraphTable::Lookup(HeapObject obj) const {
+  return entries_[IndexOf(obj)].graph;
+}
+
+
+void SharedGraphTable::ClearReached() {
+  for (intptr_t i = 0; i < length_; i++) {
+    entries_[i].reached = false;
+  }
+}
+
+
+void SharedGraphTable::ReleaseUnreached() {
+  intptr_t kept = 0;
+  for (intptr_t i = 0; i < length_; i++) {
+    if (entries_[i].reached) {
+      entries_[kept++] = entries_[i];
+    } else {
+      total_size_ -= entries_[i].graph->size();
+      entries_[i].graph->Release();
+    }
+  }
+  length_ = kept;
+}
+
+}  // namespace psoup
@@ -0,0 +1,111 @@
+// Copyright (c) 2016, the Newspeak project authors. Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_SHARED_GRAPH_H_
+#define VM_SHARED_GRAPH_H_
+
+#include <atomic>
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+#include "vm/object.h"
+#include "vm/virtual_memory.h"
+
+namespace psoup {
+
+class Isolate;
+
+// A frozen copy of an object graph that lives outside of every isolate's heap
+// and may be referenced by any number of isolates at once. The original graph
+// is copied as it is, mutable Arrays included, rather than validated as
+// immutable; it is the copy that cannot change.
+//
+// Class ids are assigned per isolate for regular objects, so only objects with
+// VM-defined class ids can be shared: Strings, Mints, Bigints, Float64s and
+// Arrays of those. ByteArrays are excluded because they are mutable in place.
+// Symbols are interned per isolate, so they are shared as plain Strings.
+//
+// Shared objects are laid out at old-space alignment with their mark bit set,
+// so scavenges and mark-sweeps treat them as live old objects and never write
+// to them. The memory is read-only once the copy is complete, so primitives
+// that store into objects or their headers must check is_shared and fail.
+//
+// Each isolate that can reach a graph holds one reference to it, and each
+// in-flight message carrying the graph holds another. An isolate drops its
+// reference at the first mark-sweep that finds no pointer into the graph, or
+// when it exits.
+class SharedGraph {
+ public:
+  // Copies the graph rooted at root, which is left untouched. Answers NULL if
+  // the graph contains anything that cannot be shared.
+  static SharedGraph* New(Isolate* isolate, HeapObject root);
+
+  HeapObject root() const { return root_; }
+  uword base() const { return memory_.base(); }
+  size_t size() const { return memory_.size(); }
+  bool Contains(HeapObject obj) const {
+    return (obj->Addr() >= memory_.base()) && (obj->Addr() < memory_.limit());
+  }
+
+  void Retain() { refcount_.fetch_add(1, std::memory_order_relaxed); }
+  void Release();
+
+ private:
+  SharedGraph(VirtualMemory memory, HeapObject root)
+      : memory_(memory), root_(root), refcount_(1) {}
+  ~SharedGraph() { memory_.Free(); }
+
+  VirtualMemory memory_;
+  HeapObject root_;
+  std::atomic<intptr_t> refcount_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedGraph);
+};
+
+// The graphs one isolate holds references to, sorted by address so the graph
+// containing a shared object is found by binary search. Each mark-sweep notes
+// the graphs it reaches and then releases the others.
+class SharedGraphTable {
+ public:
+  SharedGraphTable()
+      : entries_(NULL), length_(0), capacity_(0), total_size_(0) {}
+  ~SharedGraphTable();  // Releases every graph.
+
+  // Takes over one reference to graph, dropping it and answering false if the
+  // graph is already held.
+  bool Add(SharedGraph* graph);
+  SharedGraph* Lookup(HeapObject obj) const;
+
+  void ClearReached();
+  void MarkReached(HeapObject obj) { entries_[IndexOf(obj)].reached = true; }
+  bool IsReached(HeapObject obj) const {
+    return entries_[IndexOf(obj)].reached;
+  }
+  void ReleaseUnreached();
+
+  intptr_t length() const { return length_; }
+  // Bytes of all held graphs, which count against the old-space limit.
+  size_t total_size() const { return total_size_; }
+
+ private:
+  struct Entry {
+    SharedGraph* graph;
+    bool reached;
+  };
+
+  // Index of the first entry whose graph starts above addr.
+  intptr_t UpperBound(uword addr) const;
+  intptr_t IndexOf(HeapObject obj) const;
+
+  Entry* entries_;
+  intptr_t length_;
+  intptr_t capacity_;
+  size_t total_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedGraphTable);
+};
+
+}  // namespace psoup
+
+#endif  // VM_SHARED_GRAPH_H_
@@ -11,6 +11,10 @@
 
 namespace psoup {
 
+// Version 0 is written by PrimordialFuel. Checkpoints append the string hash
+// salt and assigned identity hashes after the root.
+static const uint16_t kCheckpointVersion = 1;
+
 class Cluster {
  public:
   Cluster() : ref_start_(0), ref_stop_(0) {}
@@ -338,7 +342,9 @@ Deserializer::Deserializer(Heap* heap, void* snapshot, size_t snapshot_length) :
   heap_(heap),
   clusters_(NULL),
   refs_(NULL),
-  next_ref_(0) {
+  next_ref_(0),
+  has_salt_(false),
+  salt_(0) {
 }
 
 
@@ -352,6 +358,23 @@ Deserializer::~Deserializer() {
 }
 
 
+bool Deserializer::IsSnapshot(const void* snapshot, size_t snapshot_length) {
+  const uint8_t* cursor = reinterpret_cast<const uint8_t*>(snapshot);
+  const uint8_t* limit = cursor + snapshot_length;
+  if ((limit - cursor >= 2) &&
+      (cursor[0] == static_cast<uint8_t>('#')) &&
+      (cursor[1] == static_cast<uint8_t>('!'))) {
+    while ((cursor < limit) && (*cursor++ != static_cast<uint8_t>('\n'))) {}
+  }
+  if (limit - cursor < 4) {
+    return false;
+  }
+  uint16_t magic = (cursor[0] << 8) | cursor[1];
+  uint16_t version = (cursor[2] << 8) | cursor[3];
+  return (magic == 0x1984) && (version <= kCheckpointVersion);
+}
+
+
 void Deserializer::Deserialize() {
   int64_t start = OS::CurrentMonotonicNanos();
 
@@ -367,7 +390,7 @@ void Deserializer::Deserialize() {
     FATAL("Wrong magic value");
   }
   uint16_t version = ReadUint16();
-  if (version != 0) {
+  if (version > kCheckpointVersion) {
     FATAL("Wrong version (%d)", version);
   }
 
@@ -390,6 +413,16 @@ void Deserializer::Deserialize() {
 
   ObjectStore os = static_cast<ObjectStore>(ReadRef());
 
+  if (version == kCheckpointVersion) {
+    has_salt_ = true;
+    salt_ = static_cast<uintptr_t>(ReadInt64());
+    intptr_t num_hashed = ReadUnsigned();
+    for (intptr_t i = 0; i < num_hashed; i++) {
+      HeapObject object = static_cast<HeapObject>(ReadRef());
+      object->set_header_hash(ReadInt64());
+    }
+  }
+
   heap_->RegisterClass(kSmiCid, os->SmallInteger());
   heap_->RegisterClass(kMintCid, os->MediumInteger());
   heap_->RegisterClass(kBigintCid, os->LargeInteger());
@@ -545,4 +578,676 @@ Cluster* Deserializer::ReadCluster() {
   }
 }
 
+
+// Maps each traced object, including SmallIntegers, to its ref. Refs are
+// assigned when nodes are written; until then a traced object maps to 0.
+class SerializerRefs {
+ public:
+  SerializerRefs() : entries_(NULL), size_(0), mask_(0) { Grow(); }
+  ~SerializerRefs() { free(entries_); }
+
+  intptr_t size() const { return size_; }
+
+  // Answers false if object was already present.
+  bool Add(Object object) {
+    if ((size_ + 1) * 2 > mask_ + 1) {
+      Grow();
+    }
+    intptr_t i = Hash(object) & mask_;
+    while (entries_[i].ref != kEmpty) {
+      if (entries_[i].object == object) {
+        return false;
+      }
+      i = (i + 1) & mask_;
+    }
+    entries_[i].object = object;
+    entries_[i].ref = 0;
+    size_++;
+    return true;
+  }
+
+  bool Includes(Object object) const { return Find(object) != NULL; }
+
+  intptr_t RefOf(Object object) const {
+    const Entry* entry = Find(object);
+    ASSERT(entry != NULL);
+    ASSERT(entry->ref > 0);
+    return entry->ref;
+  }
+
+  void SetRef(Object object, intptr_t ref) {
+    Entry* entry = const_cast<Entry*>(Find(object));
+    ASSERT(entry != NULL);
+    ASSERT(entry->ref == 0);
+    entry->ref = ref;
+  }
+
+ private:
+  static const intptr_t kEmpty = -1;
+
+  struct Entry {
+    Object object;
+    intptr_t ref;
+  };
+
+  static intptr_t Hash(Object object) {
+    uword tagged = static_cast<uword>(object);
+    return static_cast<intptr_t>(tagged ^ (tagged >> 16));
+  }
+
+  const Entry* Find(Object object) const {
+    intptr_t i = Hash(object) & mask_;
+    while (entries_[i].ref != kEmpty) {
+      if (entries_[i].object == object) {
+        return &entries_[i];
+      }
+      i = (i + 1) & mask_;
+    }
+    return NULL;
+  }
+
+  void Grow() {
+    Entry* old_entries = entries_;
+    intptr_t old_capacity = old_entries == NULL ? 0 : mask_ + 1;
+    intptr_t capacity = old_capacity == 0 ? 1024 : old_capacity * 2;
+    entries_ = reinterpret_cast<Entry*>(malloc(capacity * sizeof(Entry)));
+    if (entries_ == NULL) {
+      FATAL("Failed to allocate serializer refs\n");
+    }
+    mask_ = capacity - 1;
+    for (intptr_t i = 0; i < capacity; i++) {
+      entries_[i].ref = kEmpty;
+    }
+    for (intptr_t j = 0; j < old_capacity; j++) {
+      if (old_entries[j].ref != kEmpty) {
+        intptr_t i = Hash(old_entries[j].object) & mask_;
+        while (entries_[i].ref != kEmpty) {
+          i = (i + 1) & mask_;
+        }
+        entries_[i] = old_entries[j];
+      }
+    }
+    free(old_entries);
+  }
+
+  Entry* entries_;
+  intptr_t size_;
+  intptr_t mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(SerializerRefs);
+};
+
+
+// The instances of one class. Mirrors RegularObjectCluster in PrimordialFuel.
+class RegularObjectWriter {
+ public:
+  RegularObjectWriter(Serializer* s, Behavior klass)
+      : klass_(klass),
+        format_(klass->format()->value()),
+        transient_(new bool[format_ + 1]) {
+    ComputeTransientSlots(s);
+  }
+  ~RegularObjectWriter() { delete[] transient_; }
+
+  void Analyze(Serializer* s, RegularObject object) {
+    objects_.Add(object);
+    bool is_behavior = IsRegisteredBehavior(s, object);
+    for (intptr_t i = 0; i < format_; i++) {
+      if (!IsFiltered(i, is_behavior)) {
+        s->Enqueue(object->slot(i));
+      }
+    }
+  }
+
+  void WriteNodes(Serializer* s) {
+    s->WriteInt32(format_);
+    s->WriteUnsigned(objects_.size());
+    for (intptr_t i = 0; i < objects_.size(); i++) {
+      s->RegisterRef(objects_.At(i));
+    }
+  }
+
+  void WriteEdges(Serializer* s) {
+    s->WriteRef(klass_);
+    for (intptr_t i = 0; i < objects_.size(); i++) {
+      RegularObject object = static_cast<RegularObject>(objects_.At(i));
+      bool is_behavior = IsRegisteredBehavior(s, object);
+      for (intptr_t j = 0; j < format_; j++) {
+        s->WriteRef(IsFiltered(j, is_behavior) ? s->nil() : object->slot(j));
+      }
+    }
+  }
+
+ private:
+  // Class ids are reassigned by the deserializer.
+  static const intptr_t kClassIdSlot = 4;
+  // InstanceMixin>>_slots. ClassMixins are shorter and have no slots.
+  static const intptr_t kMixinSlotsSlot = 3;
+  // {name. isMutable. accessModifier. isTransient. source}
+  static const intptr_t kSlotIsTransient = 3;
+
+  bool IsFiltered(intptr_t index, bool is_behavior) const {
+    return transient_[index] || (is_behavior && (index == kClassIdSlot));
+  }
+
+  bool IsRegisteredBehavior(Serializer* s, RegularObject object) const {
+    if (format_ <= kClassIdSlot) {
+      return false;
+    }
+    Object id = object->slot(kClassIdSlot);
+    if (!id->IsSmallInteger()) {
+      return false;
+    }
+    intptr_t cid = static_cast<SmallInteger>(id)->value();
+    return (cid > kIllegalCid) &&
+           (cid < s->heap()->class_table_size()) &&
+           (s->heap()->ClassAt(cid) == object);
+  }
+
+  // Slots are laid out superclass first, so walk the mixins from the last slot
+  // backwards. If the mixins do not account for exactly format_ slots, nothing
+  // is filtered.
+  void ComputeTransientSlots(Serializer* s) {
+    for (intptr_t i = 0; i < format_; i++) {
+      transient_[i] = false;
+    }
+    Heap* h = s->heap();
+    Object true_obj = h->interpreter()->true_obj();
+    intptr_t cursor = format_;
+    for (Behavior cls = klass_; cls != s->nil(); cls = cls->superclass()) {
+      HeapObject mixin = cls->mixin();
+      if (!mixin->IsRegularObject() ||
+          (mixin->Klass(h)->format()->value() <= kMixinSlotsSlot)) {
+        continue;
+      }
+      Object slots = static_cast<RegularObject>(mixin)->slot(kMixinSlotsSlot);
+      if (!slots->IsArray() || (static_cast<Array>(slots)->Size() > cursor)) {
+        cursor = -1;
+        break;
+      }
+      for (intptr_t i = static_cast<Array>(slots)->Size() - 1; i >= 0; i--) {
+        Object slot = static_cast<Array>(slots)->element(i);
+        cursor--;
+        transient_[cursor] = slot->IsArray() &&
+            (static_cast<Array>(slot)->Size() > kSlotIsTransient) &&
+            (static_cast<Array>(slot)->element(kSlotIsTransient) == true_obj);
+      }
+    }
+    if (cursor != 0) {
+      for (intptr_t i = 0; i < format_; i++) {
+        transient_[i] = false;
+      }
+    }
+  }
+
+  Behavior klass_;
+  intptr_t format_;
+  bool* transient_;
+  ObjectList objects_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegularObjectWriter);
+};
+
+
+Serializer::Serializer(Heap* heap, uintptr_t salt) :
+  heap_(heap),
+  nil_(heap->interpreter()->nil_obj()),
+  salt_(salt),
+  data_(NULL),
+  length_(0),
+  capacity_(0),
+  refs_(new SerializerRefs()),
+  next_ref_(1),
+  stack_(NULL),
+  stack_size_(0),
+  stack_capacity_(0),
+  writers_(NULL),
+  num_writers_(0),
+  writers_by_cid_(NULL) {
+  intptr_t num_cids = heap->class_table_size();
+  writers_ = new RegularObjectWriter*[num_cids];
+  writers_by_cid_ = new RegularObjectWriter*[num_cids];
+  for (intptr_t i = 0; i < num_cids; i++) {
+    writers_by_cid_[i] = NULL;
+  }
+}
+
+
+Serializer::~Serializer() {
+  for (intptr_t i = 0; i < num_writers_; i++) {
+    delete writers_[i];
+  }
+  delete[] writers_;
+  delete[] writers_by_cid_;
+  free(stack_);
+  delete refs_;
+  free(data_);
+}
+
+
+void Serializer::Serialize(Object root) {
+  int64_t start = OS::CurrentMonotonicNanos();
+
+  Enqueue(nil_);
+  // The ephemeron cluster always names its class.
+  Enqueue(heap_->ClassAt(kEphemeronCid));
+  Enqueue(root);
+  do {
+    while (stack_size_ > 0) {
+      Analyze(stack_[--stack_size_]);
+    }
+  } while (RetraceEphemerons());
+
+  WriteUint16(0x1984);
+  WriteUint16(kCheckpointVersion);
+  WriteUint16(9 + num_writers_);
+  WriteUint32(refs_->size());
+  WriteNodes();
+  ASSERT(next_ref_ - 1 == refs_->size());
+  WriteEdges();
+  WriteRef(root);
+
+  WriteInt64(static_cast<int64_t>(salt_));
+  WriteUnsigned(hashed_.size());
+  for (intptr_t i = 0; i < hashed_.size(); i++) {
+    WriteRef(hashed_.At(i));
+    WriteInt64(static_cast<HeapObject>(hashed_.At(i))->header_hash());
+  }
+
+  int64_t stop = OS::CurrentMonotonicNanos();
+  intptr_t time = stop - start;
+  if (TRACE_GROWTH) {
+    OS::PrintErr("Serialized %" Pd "kB heap "
+                 "into %" Pd "kB snapshot "
+                 "with %" Pd " objects "
+                 "in %" Pd " us\n",
+                 heap_->Size() / KB,
+                 length_ / KB,
+                 refs_->size(),
+                 time / kNanosecondsPerMicrosecond);
+  }
+}
+
+
+void Serializer::Enqueue(Object object) {
+  if (!refs_->Add(object)) {
+    return;
+  }
+  if (stack_size_ == stack_capacity_) {
+    stack_capacity_ = stack_capacity_ == 0 ? 1024 : stack_capacity_ * 2;
+    stack_ = reinterpret_cast<Object*>(
+        realloc(stack_, stack_capacity_ * sizeof(Object)));
+    if (stack_ == NULL) {
+      FATAL("Failed to allocate serializer stack\n");
+    }
+  }
+  stack_[stack_size_++] = object;
+}
+
+
+bool Serializer::HasRef(Object object) const {
+  return refs_->Includes(object);
+}
+
+
+bool Serializer::IsDeadActivation(Activation activation) const {
+  // Between messages no frames are live, so an activation still pointing at
+  // a frame describes one that has already returned.
+  return activation->sender()->IsSmallInteger();
+}
+
+
+void Serializer::Analyze(Object object) {
+  if (object->IsHeapObject() && !object->IsString() &&
+      (static_cast<HeapObject>(object)->header_hash() != 0)) {
+    // String hashes are recomputed from the salt.
+    hashed_.Add(object);
+  }
+
+  switch (object->ClassId()) {
+  case kSmiCid:
+  case kMintCid:
+    integers_.Add(object);
+    return;
+  case kBigintCid:
+    large_integers_.Add(object);
+    return;
+  case kFloat64Cid:
+    floats_.Add(object);
+    return;
+  case kByteArrayCid:
+    byte_arrays_.Add(object);
+    return;
+  case kStringCid:
+    if (static_cast<String>(object)->is_canonical()) {
+      symbols_.Add(object);
+    } else {
+      strings_.Add(object);
+    }
+    return;
+  case kArrayCid: {
+    arrays_.Add(object);
+    Array array = static_cast<Array>(object);
+    for (intptr_t i = 0; i < array->Size(); i++) {
+      Enqueue(array->element(i));
+    }
+    return;
+  }
+  case kWeakArrayCid: {
+    weak_arrays_.Add(object);
+    // Not traced, but immediates are never cleared.
+    WeakArray array = static_cast<WeakArray>(object);
+    for (intptr_t i = 0; i < array->Size(); i++) {
+      if (array->element(i)->IsImmediateObject()) {
+        Enqueue(array->element(i));
+      }
+    }
+    return;
+  }
+  case kEphemeronCid:
+    ephemerons_.Add(object);
+    Enqueue(static_cast<Ephemeron>(object)->finalizer());
+    return;
+  case kActivationCid: {
+    activations_.Add(object);
+    Activation activation = static_cast<Activation>(object);
+    if (!IsDeadActivation(activation)) {
+      Enqueue(activation->sender());
+      Enqueue(activation->bci());
+    }
+    Enqueue(activation->method());
+    Enqueue(activation->closure());
+    Enqueue(activation->receiver());
+    for (intptr_t i = 0; i < activation->StackDepth(); i++) {
+      Enqueue(activation->temp(i));
+    }
+    return;
+  }
+  case kClosureCid: {
+    closures_.Add(object);
+    Closure closure = static_cast<Closure>(object);
+    Enqueue(closure->defining_activation());
+    Enqueue(closure->initial_bci());
+    Enqueue(closure->num_args());
+    for (intptr_t i = 0; i < closure->NumCopied(); i++) {
+      Enqueue(closure->copied(i));
+    }
+    return;
+  }
+  case kIllegalCid:
+  case kForwardingCorpseCid:
+  case kFreeListElementCid:
+    UNREACHABLE();
+    return;
+  default:
+    WriterFor(object->ClassId())->Analyze(this,
+                                          static_cast<RegularObject>(object));
+    return;
+  }
+}
+
+
+bool Serializer::RetraceEphemerons() {
+  bool found = false;
+  for (intptr_t i = 0; i < ephemerons_.size(); i++) {
+    Ephemeron ephemeron = static_cast<Ephemeron>(ephemerons_.At(i));
+    if ((ephemeron->key()->IsImmediateObject() || HasRef(ephemeron->key())) &&
+        !HasRef(ephemeron->value())) {
+      Enqueue(ephemeron->key());
+      Enqueue(ephemeron->value());
+      found = true;
+    }
+  }
+  return found;
+}
+
+
+RegularObjectWriter* Serializer::WriterFor(intptr_t cid) {
+  ASSERT(cid >= kFirstRegularObjectCid);
+  ASSERT(cid < heap_->class_table_size());
+  RegularObjectWriter* writer = writers_by_cid_[cid];
+  if (writer == NULL) {
+    Behavior klass = heap_->ClassAt(cid);
+    Enqueue(klass);
+    writer = new RegularObjectWriter(this, klass);
+    writers_by_cid_[cid] = writer;
+    writers_[num_writers_++] = writer;
+  }
+  return writer;
+}
+
+
+void Serializer::WriteNodes() {
+  WriteInt32(-kSmiCid);
+  WriteUnsigned(integers_.size());
+  for (intptr_t i = 0; i < integers_.size(); i++) {
+    Object integer = integers_.At(i);
+    RegisterRef(integer);
+    if (integer->IsSmallInteger()) {
+      WriteInt64(static_cast<SmallInteger>(integer)->value());
+    } else {
+      WriteInt64(static_cast<MediumInteger>(integer)->value());
+    }
+  }
+  WriteUnsigned(large_integers_.size());
+  for (intptr_t i = 0; i < large_integers_.size(); i++) {
+    LargeInteger large = static_cast<LargeInteger>(large_integers_.At(i));
+    RegisterRef(large);
+    WriteUint8(large->negative() ? 1 : 0);
+    intptr_t digits = large->size();
+    intptr_t bytes = 0;
+    if (digits > 0) {
+      bytes = (digits - 1) * sizeof(digit_t);
+      for (digit_t top = large->digit(digits - 1); top != 0; top >>= 8) {
+        bytes++;
+      }
+    }
+    WriteUint16(bytes);
+    for (intptr_t j = 0; j < bytes; j++) {
+      digit_t digit = large->digit(j / sizeof(digit_t));
+      WriteUint8((digit >> ((j % sizeof(digit_t)) * 8)) & 0xFF);
+    }
+  }
+
+  WriteInt32(-kFloat64Cid);
+  WriteUnsigned(floats_.size());
+  for (intptr_t i = 0; i < floats_.size(); i++) {
+    RegisterRef(floats_.At(i));
+    WriteFloat64(static_cast<Float64>(floats_.At(i))->value());
+  }
+
+  WriteInt32(-kByteArrayCid);
+  WriteUnsigned(byte_arrays_.size());
+  for (intptr_t i = 0; i < byte_arrays_.size(); i++) {
+    ByteArray bytes = static_cast<ByteArray>(byte_arrays_.At(i));
+    RegisterRef(bytes);
+    WriteUnsigned(bytes->Size());
+    for (intptr_t j = 0; j < bytes->Size(); j++) {
+      WriteUint8(bytes->element(j));
+    }
+  }
+
+  WriteInt32(-kStringCid);
+  ObjectList* string_lists[] = { &strings_, &symbols_ };
+  for (intptr_t k = 0; k < 2; k++) {
+    ObjectList* list = string_lists[k];
+    WriteUnsigned(list->size());
+    for (intptr_t i = 0; i < list->size(); i++) {
+      String string = static_cast<String>(list->At(i));
+      RegisterRef(string);
+      WriteUnsigned(string->Size());
+      for (intptr_t j = 0; j < string->Size(); j++) {
+        WriteUint8(string->element(j));
+      }
+    }
+  }
+
+  WriteInt32(-kArrayCid);
+  WriteUnsigned(arrays_.size());
+  for (intptr_t i = 0; i < arrays_.size(); i++) {
+    RegisterRef(arrays_.At(i));
+    WriteUnsigned(static_cast<Array>(arrays_.At(i))->Size());
+  }
+
+  WriteInt32(-kWeakArrayCid);
+  WriteUnsigned(weak_arrays_.size());
+  for (intptr_t i = 0; i < weak_arrays_.size(); i++) {
+    RegisterRef(weak_arrays_.At(i));
+    WriteUnsigned(static_cast<WeakArray>(weak_arrays_.At(i))->Size());
+  }
+
+  WriteInt32(-kEphemeronCid);
+  WriteUnsigned(ephemerons_.size());
+  for (intptr_t i = 0; i < ephemerons_.size(); i++) {
+    RegisterRef(ephemerons_.At(i));
+  }
+
+  WriteInt32(-kActivationCid);
+  WriteUnsigned(activations_.size());
+  for (intptr_t i = 0; i < activations_.size(); i++) {
+    RegisterRef(activations_.At(i));
+  }
+
+  WriteInt32(-kClosureCid);
+  WriteUnsigned(closures_.size());
+  for (intptr_t i = 0; i < closures_.size(); i++) {
+    RegisterRef(closures_.At(i));
+    WriteUint16(static_cast<Closure>(closures_.At(i))->NumCopied());
+  }
+
+  for (intptr_t i = 0; i < num_writers_; i++) {
+    writers_[i]->WriteNodes(this);
+  }
+}
+
+
+void Serializer::WriteEdges() {
+  for (intptr_t i = 0; i < arrays_.size(); i++) {
+    Array array = static_cast<Array>(arrays_.At(i));
+    for (intptr_t j = 0; j < array->Size(); j++) {
+      WriteRef(array->element(j));
+    }
+  }
+
+  for (intptr_t i = 0; i < weak_arrays_.size(); i++) {
+    WeakArray array = static_cast<WeakArray>(weak_arrays_.At(i));
+    for (intptr_t j = 0; j < array->Size(); j++) {
+      WriteWeakRef(array->element(j));
+    }
+  }
+
+  WriteRef(heap_->ClassAt(kEphemeronCid));
+  for (intptr_t i = 0; i < ephemerons_.size(); i++) {
+    Ephemeron ephemeron = static_cast<Ephemeron>(ephemerons_.At(i));
+    WriteWeakRef(ephemeron->key());
+    WriteWeakRef(ephemeron->value());
+    WriteRef(ephemeron->finalizer());
+  }
+
+  for (intptr_t i = 0; i < activations_.size(); i++) {
+    Activation activation = static_cast<Activation>(activations_.At(i));
+    if (IsDeadActivation(activation)) {
+      WriteRef(nil_);
+      WriteRef(nil_);
+    } else {
+      WriteRef(activation->sender());
+      WriteRef(activation->bci());
+    }
+    WriteRef(activation->method());
+    WriteRef(activation->closure());
+    WriteRef(activation->receiver());
+    WriteUint16(activation->StackDepth());
+    for (intptr_t j = 0; j < activation->StackDepth(); j++) {
+      WriteRef(activation->temp(j));
+    }
+  }
+
+  for (intptr_t i = 0; i < closures_.size(); i++) {
+    Closure closure = static_cast<Closure>(closures_.At(i));
+    WriteRef(closure->defining_activation());
+    WriteRef(closure->initial_bci());
+    WriteRef(closure->num_args());
+    for (intptr_t j = 0; j < closure->NumCopied(); j++) {
+      WriteRef(closure->copied(j));
+    }
+  }
+
+  for (intptr_t i = 0; i < num_writers_; i++) {
+    writers_[i]->WriteEdges(this);
+  }
+}
+
+
+void Serializer::RegisterRef(Object object) {
+  refs_->SetRef(object, next_ref_++);
+}
+
+
+void Serializer::WriteRef(Object object) {
+  WriteUnsigned(refs_->RefOf(object));
+}
+
+
+void Serializer::WriteWeakRef(Object object) {
+  WriteRef(HasRef(object) ? object : nil_);
+}
+
+
+void Serializer::WriteUint8(uint8_t value) {
+  if (length_ == capacity_) {
+    capacity_ = capacity_ == 0 ? 64 * KB : capacity_ * 2;
+    data_ = reinterpret_cast<uint8_t*>(realloc(data_, capacity_));
+    if (data_ == NULL) {
+      FATAL("Failed to allocate %" Pd " bytes\n", capacity_);
+    }
+  }
+  data_[length_++] = value;
+}
+
+
+void Serializer::WriteUint16(uint16_t value) {
+  WriteUint8(value >> 8);
+  WriteUint8(value);
+}
+
+
+void Serializer::WriteUint32(uint32_t value) {
+  WriteUint8(value >> 24);
+  WriteUint8(value >> 16);
+  WriteUint8(value >> 8);
+  WriteUint8(value);
+}
+
+
+void Serializer::WriteInt32(int32_t value) {
+  WriteUint32(static_cast<uint32_t>(value));
+}
+
+
+void Serializer::WriteInt64(int64_t value) {
+  uint64_t bits = static_cast<uint64_t>(value);
+  for (intptr_t shift = 56; shift >= 0; shift -= 8) {
+    WriteUint8(bits >> shift);
+  }
+}
+
+
+void Serializer::WriteFloat64(double value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  for (size_t i = 0; i < sizeof(double); i++) {
+    WriteUint8(bytes[i]);
+  }
+}
+
+
+void Serializer::WriteUnsigned(intptr_t value) {
+  ASSERT(value >= 0);
+  uintptr_t v = static_cast<uintptr_t>(value);
+  while (v > static_cast<uintptr_t>(kMaxUnsignedDataPerByte)) {
+    WriteUint8(v & kByteMask);
+    v >>= kDataBitsPerByte;
+  }
+  WriteUint8(v + kEndUnsignedByteMarker);
+}
+
 }  // namespace psoup
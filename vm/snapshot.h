@@ -15,6 +15,38 @@ class Cluster;
 class Heap;
 class Object;
 
+// A growable list of objects outside of the heap. Not a GC root.
+class ObjectList {
+ public:
+  ObjectList() : objects_(NULL), size_(0), capacity_(0) {}
+  ~ObjectList() { free(objects_); }
+
+  void Add(Object object) {
+    if (size_ == capacity_) {
+      capacity_ = capacity_ == 0 ? 64 : capacity_ * 2;
+      objects_ = reinterpret_cast<Object*>(
+          realloc(objects_, capacity_ * sizeof(Object)));
+      if (objects_ == NULL) {
+        FATAL("Failed to allocate object list\n");
+      }
+    }
+    objects_[size_++] = object;
+  }
+
+  intptr_t size() const { return size_; }
+  Object At(intptr_t index) const {
+    ASSERT((index >= 0) && (index < size_));
+    return objects_[index];
+  }
+
+ private:
+  Object* objects_;
+  intptr_t size_;
+  intptr_t capacity_;
+
+  DISALLOW_COPY_AND_ASSIGN(ObjectList);
+};
+
 // Reads a variant of VictoryFuel.
 class Deserializer : public ValueObject {
  public:
@@ -32,6 +64,18 @@ class Deserializer : public ValueObject {
 
   void Deserialize();
 
+  // Whether snapshot starts like one Deserialize can read, so bytes that are
+  // not a snapshot at all can be refused before an isolate is started from
+  // them. Only the header is checked. Like the snapshot the VM starts from,
+  // the body is trusted: a truncated or corrupt one fails in Deserialize,
+  // which takes down the whole process.
+  static bool IsSnapshot(const void* snapshot, size_t snapshot_length);
+
+  // Checkpoints carry the writer's string hash salt so hashed collections
+  // remain valid.
+  bool has_salt() const { return has_salt_; }
+  uintptr_t salt() const { return salt_; }
+
   Cluster* ReadCluster();
 
   intptr_t next_ref() const { return next_ref_; }
@@ -60,6 +104,92 @@ class Deserializer : public ValueObject {
 
   Object* refs_;
   intptr_t next_ref_;
+
+  bool has_salt_;
+  uintptr_t salt_;
+};
+
+class RegularObjectWriter;
+class SerializerRefs;
+
+// Writes the same variant of VictoryFuel from a live heap, so an isolate can be
+// checkpointed without running the Newspeak serializer. Weak references to
+// objects that are not otherwise reachable are written as nil, and transient
+// slots and class ids are dropped as in PrimordialFuel's Serializer. Unlike
+// PrimordialFuel's output, identity hashes and the string hash salt are kept
+// so the checkpoint's hashed collections need no rehashing.
+class Serializer : public ValueObject {
+ public:
+  Serializer(Heap* heap, uintptr_t salt);
+  ~Serializer();
+
+  // Must not be interrupted by a GC.
+  void Serialize(Object root);
+
+  const uint8_t* data() const { return data_; }
+  intptr_t length() const { return length_; }
+
+  void WriteUint8(uint8_t value);
+  void WriteUint16(uint16_t value);
+  void WriteUint32(uint32_t value);
+  void WriteInt32(int32_t value);
+  void WriteInt64(int64_t value);
+  void WriteFloat64(double value);
+  void WriteUnsigned(intptr_t value);
+
+  void WriteRef(Object object);
+  void WriteWeakRef(Object object);
+  void RegisterRef(Object object);
+
+  void Enqueue(Object object);
+  bool HasRef(Object object) const;
+
+  Heap* heap() const { return heap_; }
+  Object nil() const { return nil_; }
+
+ private:
+  void Analyze(Object object);
+  bool RetraceEphemerons();
+  RegularObjectWriter* WriterFor(intptr_t cid);
+  void WriteNodes();
+  void WriteEdges();
+  bool IsDeadActivation(Activation activation) const;
+
+  Heap* const heap_;
+  const Object nil_;
+  const uintptr_t salt_;
+
+  uint8_t* data_;
+  intptr_t length_;
+  intptr_t capacity_;
+
+  SerializerRefs* refs_;
+  intptr_t next_ref_;
+
+  Object* stack_;
+  intptr_t stack_size_;
+  intptr_t stack_capacity_;
+
+  // Fixed clusters, in the order PrimordialFuel writes them.
+  ObjectList integers_;
+  ObjectList large_integers_;
+  ObjectList floats_;
+  ObjectList byte_arrays_;
+  ObjectList strings_;
+  ObjectList symbols_;
+  ObjectList arrays_;
+  ObjectList weak_arrays_;
+  ObjectList ephemerons_;
+  ObjectList activations_;
+  ObjectList closures_;
+
+  // Objects whose identity hash has been assigned.
+  ObjectList hashed_;
+
+  // Regular object clusters, in discovery order and by class id.
+  RegularObjectWriter** writers_;
+  intptr_t num_writers_;
+  RegularObjectWriter** writers_by_cid_;
 };
 
 }  // namespace psoup
@@ -0,0 +1,75 @@
+// Copyright (c) 2016, the Newspeak project authors. Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_SPIN_BUDGET_H_
+#define VM_SPIN_BUDGET_H_
+
+#include <atomic>
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+#include "vm/os.h"
+
+#if defined(__i386__) || defined(__x86_64__) || \
+    defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace psoup {
+
+// How long a waiter busy-waits for a handoff before blocking in the kernel.
+// Handoffs between isolates usually complete within a few microseconds, less
+// than a sleep and wakeup cost, but waits for new work may last indefinitely.
+// The budget doubles each time spinning sees the awaited change and halves
+// each time the waiter blocks anyway, so a wait that is usually long costs
+// only a short spin on top of blocking.
+//
+// Updates from concurrent waiters may be lost; the budget is only a hint.
+class SpinBudget {
+ public:
+  // With one processor, the thread being waited for cannot run while we spin,
+  // so the budget stays at zero.
+  SpinBudget()
+      : limit_(OS::NumberOfAvailableProcessors() > 1 ? kInitialSpins : 0) {}
+
+  intptr_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+  void Succeeded() {
+    intptr_t limit = limit_.load(std::memory_order_relaxed);
+    if (limit < kMaxSpins) {
+      limit_.store(limit * 2, std::memory_order_relaxed);
+    }
+  }
+
+  void Failed() {
+    intptr_t limit = limit_.load(std::memory_order_relaxed);
+    if (limit > kMinSpins) {
+      limit_.store(limit / 2, std::memory_order_relaxed);
+    }
+  }
+
+  // Hints to the processor that this is a spin-wait loop.
+  static void Relax() {
+#if defined(__i386__) || defined(__x86_64__) || \
+    defined(_M_IX86) || defined(_M_X64)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+  }
+
+ private:
+  // In iterations of Relax, which takes tens of cycles on recent processors.
+  static constexpr intptr_t kMinSpins = 8;
+  static constexpr intptr_t kInitialSpins = 128;
+  static constexpr intptr_t kMaxSpins = 1024;
+
+  std::atomic<intptr_t> limit_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpinBudget);
+};
+
+}  // namespace psoup
+
+#endif  // VM_SPIN_BUDGET_H_
@@ -8,6 +8,7 @@
 #include "vm/thread.h"
 
 #include <errno.h>         // NOLINT
+#include <linux/futex.h>   // NOLINT
 #include <sys/resource.h>  // NOLINT
 #include <sys/syscall.h>   // NOLINT
 #include <sys/time.h>      // NOLINT
@@ -18,23 +19,6 @@
 
 namespace psoup {
 
-#define VALIDATE_PTHREAD_RESULT(result)                                        \
-  if (result != 0) {                                                           \
-    const int kBufferSize = 1024;                                              \
-    char error_message[kBufferSize];                                           \
-    Utils::StrError(result, error_message, kBufferSize);                       \
-    FATAL("pthread error: %d (%s)", result, error_message);                    \
-  }
-
-
-#if defined(DEBUG)
-#define ASSERT_PTHREAD_SUCCESS(result) VALIDATE_PTHREAD_RESULT(result)
-#else
-// NOTE: This (currently) expands to a no-op.
-#define ASSERT_PTHREAD_SUCCESS(result) ASSERT(result == 0)
-#endif
-
-
 #ifdef DEBUG
 #define RETURN_ON_PTHREAD_FAILURE(result)                                      \
   if (result != 0) {                                                           \
@@ -153,23 +137,77 @@ bool Thread::Compare(ThreadId a, ThreadId b) {
 }
 
 
-Mutex::Mutex() {
-  pthread_mutexattr_t attr;
-  int result = pthread_mutexattr_init(&attr);
-  VALIDATE_PTHREAD_RESULT(result);
+static int FutexWait(std::atomic<int32_t>* word,
+                     int32_t expected,
+                     const struct timespec* deadline) {
+  // Unlike FUTEX_WAIT, FUTEX_WAIT_BITSET takes an absolute deadline, on the
+  // same clock as OS::CurrentMonotonicNanos.
+  return syscall(SYS_futex, reinterpret_cast<int32_t*>(word),
+                 FUTEX_WAIT_BITSET_PRIVATE, expected, deadline, NULL,
+                 FUTEX_BITSET_MATCH_ANY);
+}
+
+
+static void FutexWake(std::atomic<int32_t>* word, int32_t count) {
+  syscall(SYS_futex, reinterpret_cast<int32_t*>(word), FUTEX_WAKE_PRIVATE,
+          count, NULL, NULL, 0);
+}
+
+
+void FutexLock::LockSlow() {
+  intptr_t limit = spin_.limit();
+  for (intptr_t i = 0; i < limit; i++) {
+    SpinBudget::Relax();
+    if ((state_.load(std::memory_order_relaxed) == kUnlocked) && TryLock()) {
+      spin_.Succeeded();
+      return;
+    }
+  }
+  spin_.Failed();
+
+  // Whoever releases the lock next will wake a sleeper. Having taken the lock
+  // here, we cannot tell whether others are still asleep, so we conservatively
+  // leave it marked.
+  while (state_.exchange(kSleepers, std::memory_order_acquire) != kUnlocked) {
+    FutexWait(&state_, kSleepers, NULL);
+  }
+}
 
-#if defined(DEBUG)
-  result = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
-  VALIDATE_PTHREAD_RESULT(result);
-#endif  // defined(DEBUG)
 
-  result = pthread_mutex_init(data_.mutex(), &attr);
-  // Verify that creating a pthread_mutex succeeded.
-  VALIDATE_PTHREAD_RESULT(result);
+void FutexLock::UnlockSlow() {
+  FutexWake(&state_, 1);
+}
 
-  result = pthread_mutexattr_destroy(&attr);
-  VALIDATE_PTHREAD_RESULT(result);
 
+// Answers whether sequence moved on from seen before the deadline, if any.
+static bool AwaitNotification(std::atomic<int32_t>* sequence,
+                              std::atomic<int32_t>* sleepers,
+                              SpinBudget* spin,
+                              int32_t seen,
+                              const struct timespec* deadline) {
+  intptr_t limit = spin->limit();
+  for (intptr_t i = 0; i < limit; i++) {
+    SpinBudget::Relax();
+    if (sequence->load(std::memory_order_relaxed) != seen) {
+      spin->Succeeded();
+      return true;
+    }
+  }
+  spin->Failed();
+
+  // Pairs with Notify: either it sees us asleep or we see its increment.
+  sleepers->fetch_add(1, std::memory_order_seq_cst);
+  while (sequence->load(std::memory_order_seq_cst) == seen) {
+    if ((FutexWait(sequence, seen, deadline) != 0) && (errno == ETIMEDOUT)) {
+      break;
+    }
+  }
+  sleepers->fetch_sub(1, std::memory_order_relaxed);
+  return sequence->load(std::memory_order_relaxed) != seen;
+}
+
+
+Mutex::Mutex() {
 #if defined(DEBUG)
   // When running with assertions enabled we track the owner.
   owner_ = Thread::kInvalidThreadId;
@@ -178,10 +216,6 @@ Mutex::Mutex() {
 
 
 Mutex::~Mutex() {
-  int result = pthread_mutex_destroy(data_.mutex());
-  // Verify that the pthread_mutex was destroyed.
-  VALIDATE_PTHREAD_RESULT(result);
-
 #if defined(DEBUG)
   // When running with assertions enabled we track the owner.
   ASSERT(owner_ == Thread::kInvalidThreadId);
@@ -190,21 +224,16 @@ Mutex::~Mutex() {
 
 
 void Mutex::Lock() {
-  int result = pthread_mutex_lock(data_.mutex());
-  // Specifically check for dead lock to help debugging.
-  ASSERT(result != EDEADLK);
-  ASSERT_PTHREAD_SUCCESS(result);  // Verify no other errors.
+  data_.lock()->Lock();
   CheckUnheldAndMark();
 }
 
 
 bool Mutex::TryLock() {
-  int result = pthread_mutex_trylock(data_.mutex());
   // Return false if the lock is busy and locking failed.
-  if (result == EBUSY) {
+  if (!data_.lock()->TryLock()) {
     return false;
   }
-  ASSERT_PTHREAD_SUCCESS(result);  // Verify no other errors.
   CheckUnheldAndMark();
   return true;
 }
@@ -212,42 +241,11 @@ bool Mutex::TryLock() {
 
 void Mutex::Unlock() {
   CheckHeldAndUnmark();
-  int result = pthread_mutex_unlock(data_.mutex());
-  // Specifically check for wrong thread unlocking to aid debugging.
-  ASSERT(result != EPERM);
-  ASSERT_PTHREAD_SUCCESS(result);  // Verify no other errors.
+  data_.lock()->Unlock();
 }
 
 
 Monitor::Monitor() {
-  pthread_mutexattr_t mutex_attr;
-  int result = pthread_mutexattr_init(&mutex_attr);
-  VALIDATE_PTHREAD_RESULT(result);
-
-#if defined(DEBUG)
-  result = pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_ERRORCHECK);
-  VALIDATE_PTHREAD_RESULT(result);
-#endif  // defined(DEBUG)
-
-  result = pthread_mutex_init(data_.mutex(), &mutex_attr);
-  VALIDATE_PTHREAD_RESULT(result);
-
-  result = pthread_mutexattr_destroy(&mutex_attr);
-  VALIDATE_PTHREAD_RESULT(result);
-
-  pthread_condattr_t cond_attr;
-  result = pthread_condattr_init(&cond_attr);
-  VALIDATE_PTHREAD_RESULT(result);
-
-  result = pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
-  VALIDATE_PTHREAD_RESULT(result);
-
-  result = pthread_cond_init(data_.cond(), &cond_attr);
-  VALIDATE_PTHREAD_RESULT(result);
-
-  result = pthread_condattr_destroy(&cond_attr);
-  VALIDATE_PTHREAD_RESULT(result);
-
 #if defined(DEBUG)
   // When running with assertions enabled we track the owner.
   owner_ = Thread::kInvalidThreadId;
@@ -260,45 +258,40 @@ Monitor::~Monitor() {
   // When running with assertions enabled we track the owner.
   ASSERT(owner_ == Thread::kInvalidThreadId);
 #endif  // defined(DEBUG)
-
-  int result = pthread_mutex_destroy(data_.mutex());
-  VALIDATE_PTHREAD_RESULT(result);
-
-  result = pthread_cond_destroy(data_.cond());
-  VALIDATE_PTHREAD_RESULT(result);
+  ASSERT(data_.sleepers_.load(std::memory_order_relaxed) == 0);
 }
 
 
 bool Monitor::TryEnter() {
-  int result = pthread_mutex_trylock(data_.mutex());
   // Return false if the lock is busy and locking failed.
-  if (result == EBUSY) {
+  if (!data_.lock()->TryLock()) {
     return false;
   }
-  ASSERT_PTHREAD_SUCCESS(result);  // Verify no other errors.
   CheckUnheldAndMark();
   return true;
 }
 
 
 void Monitor::Enter() {
-  int result = pthread_mutex_lock(data_.mutex());
-  VALIDATE_PTHREAD_RESULT(result);
+  data_.lock()->Lock();
   CheckUnheldAndMark();
 }
 
 
 void Monitor::Exit() {
   CheckHeldAndUnmark();
-  int result = pthread_mutex_unlock(data_.mutex());
-  VALIDATE_PTHREAD_RESULT(result);
+  data_.lock()->Unlock();
 }
 
 
 void Monitor::Wait() {
   CheckHeldAndUnmark();
-  int result = pthread_cond_wait(data_.cond(), data_.mutex());
-  VALIDATE_PTHREAD_RESULT(result);
+  // Notifiers hold the lock, so this is the latest notification.
+  int32_t seen = data_.sequence_.load(std::memory_order_relaxed);
+  data_.lock()->Unlock();
+  AwaitNotification(&data_.sequence_, &data_.sleepers_, &data_.spin_, seen,
+                    NULL);
+  data_.lock()->Lock();
   CheckUnheldAndMark();
 }
 
@@ -306,7 +299,6 @@ void Monitor::Wait() {
 Monitor::WaitResult Monitor::WaitUntilNanos(int64_t deadline) {
   CheckHeldAndUnmark();
 
-  Monitor::WaitResult retval = kNotified;
   struct timespec ts;
   int64_t secs = deadline / kNanosecondsPerSecond;
   int64_t nanos = deadline % kNanosecondsPerSecond;
@@ -316,30 +308,35 @@ Monitor::WaitResult Monitor::WaitUntilNanos(int64_t deadline) {
   }
   ts.tv_sec = static_cast<int32_t>(secs);
   ts.tv_nsec = static_cast<long>(nanos);  // NOLINT (long used in timespec).
-  int result = pthread_cond_timedwait(data_.cond(), data_.mutex(), &ts);
-  ASSERT((result == 0) || (result == ETIMEDOUT));
-  if (result == ETIMEDOUT) {
-    retval = kTimedOut;
-  }
+
+  int32_t seen = data_.sequence_.load(std::memory_order_relaxed);
+  data_.lock()->Unlock();
+  bool notified = AwaitNotification(&data_.sequence_, &data_.sleepers_,
+                                    &data_.spin_, seen, &ts);
+  data_.lock()->Lock();
 
   CheckUnheldAndMark();
-  return retval;
+  return notified ? kNotified : kTimedOut;
 }
 
 
 void Monitor::Notify() {
   // When running with assertions enabled we track the owner.
   DEBUG_ASSERT(IsOwnedByCurrentThread());
-  int result = pthread_cond_signal(data_.cond());
-  VALIDATE_PTHREAD_RESULT(result);
+  data_.sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (data_.sleepers_.load(std::memory_order_seq_cst) > 0) {
+    FutexWake(&data_.sequence_, 1);
+  }
 }
 
 
 void Monitor::NotifyAll() {
   // When running with assertions enabled we track the owner.
   DEBUG_ASSERT(IsOwnedByCurrentThread());
-  int result = pthread_cond_broadcast(data_.cond());
-  VALIDATE_PTHREAD_RESULT(result);
+  data_.sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (data_.sleepers_.load(std::memory_order_seq_cst) > 0) {
+    FutexWake(&data_.sequence_, kMaxInt32);
+  }
 }
 
 }  // namespace psoup
@@ -11,22 +11,62 @@
 
 #include <pthread.h>
 
+#include <atomic>
+
 #include "vm/assert.h"
 #include "vm/globals.h"
+#include "vm/spin_budget.h"
 
 namespace psoup {
 
 typedef pthread_t ThreadId;
 typedef pthread_t ThreadJoinId;
 
+// A lock in a single futex word. A contended Lock spins while the holder is
+// likely to release soon and only then sleeps in the kernel, and Unlock only
+// enters the kernel if some thread is asleep.
+class FutexLock {
+ public:
+  FutexLock() : state_(kUnlocked) {}
+
+  bool TryLock() {
+    int32_t expected = kUnlocked;
+    return state_.compare_exchange_strong(expected, kLocked,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+  void Lock() {
+    if (!TryLock()) {
+      LockSlow();
+    }
+  }
+  void Unlock() {
+    if (state_.exchange(kUnlocked, std::memory_order_release) == kSleepers) {
+      UnlockSlow();
+    }
+  }
+
+ private:
+  enum { kUnlocked = 0, kLocked = 1, kSleepers = 2 };
+
+  void LockSlow();
+  void UnlockSlow();
+
+  std::atomic<int32_t> state_;
+  SpinBudget spin_;
+
+  DISALLOW_COPY_AND_ASSIGN(FutexLock);
+};
+
+
 class MutexData {
  private:
   MutexData() {}
   ~MutexData() {}
 
-  pthread_mutex_t* mutex() { return &mutex_; }
+  FutexLock* lock() { return &lock_; }
 
-  pthread_mutex_t mutex_;
+  FutexLock lock_;
 
   friend class Mutex;
 
@@ -35,16 +75,20 @@ class MutexData {
 };
 
 
+// A condition is a futex word counting notifications. Waiters spin on it
+// before sleeping, and notifiers only enter the kernel if some waiter is
+// asleep.
 class MonitorData {
  private:
-  MonitorData() {}
+  MonitorData() : sequence_(0), sleepers_(0) {}
   ~MonitorData() {}
 
-  pthread_mutex_t* mutex() { return &mutex_; }
-  pthread_cond_t* cond() { return &cond_; }
+  FutexLock* lock() { return &lock_; }
 
-  pthread_mutex_t mutex_;
-  pthread_cond_t cond_;
+  FutexLock lock_;
+  std::atomic<int32_t> sequence_;
+  std::atomic<int32_t> sleepers_;
+  SpinBudget spin_;
 
   friend class Monitor;
 